@@ -0,0 +1,96 @@
+#include "chunk.hpp"
+#include "chunk_compression.hpp"
+#include "chunk_light.hpp"
+
+#include <chrono>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static constexpr size_t CHUNK_COUNT    = 256;
+static constexpr size_t DECODE_REPEATS = 16;
+static constexpr size_t LAYERED_HEIGHT = 128;
+
+// Stone, then dirt, then a single layer of grass, with air above a surface
+// that vary a little from column to column. This is closer to what real
+// terrain look like than the noise produced by chunk_generate_random.
+static Chunk chunk_generate_layered(unsigned seed)
+{
+  Chunk chunk = chunk_create(LAYERED_HEIGHT);
+  for(size_t y=0; y<CHUNK_SIZE; ++y)
+    for(size_t x=0; x<CHUNK_SIZE; ++x)
+    {
+      const size_t surface = LAYERED_HEIGHT / 2 + (seed + x * 3 + y * 5) % 7;
+      for(size_t z=0; z<surface; ++z)
+      {
+        const BlockType type = z + 1 == surface ? BlockType::GRASS : z + 4 >= surface ? BlockType::DIRT : BlockType::STONE;
+        chunk_set_block(chunk, x, y, z, type);
+      }
+    }
+  return chunk;
+}
+
+static void benchmark(const char *name, Chunk (*generate)(unsigned seed))
+{
+  Chunk           chunks[CHUNK_COUNT];
+  CompressedChunk compressed_chunks[CHUNK_COUNT];
+
+  size_t block_count        = 0;
+  size_t uncompressed_bytes = 0;
+  size_t compressed_bytes   = 0;
+  for(size_t i=0; i<CHUNK_COUNT; ++i)
+  {
+    chunks[i] = generate(i);
+    chunk_light_init(chunks[i]);
+    block_count        += CHUNK_SIZE * CHUNK_SIZE * chunks[i].height;
+    uncompressed_bytes += chunk_memory_usage(chunks[i]);
+  }
+
+  auto encode_begin = std::chrono::steady_clock::now();
+  for(size_t i=0; i<CHUNK_COUNT; ++i)
+  {
+    compressed_chunks[i] = chunk_compress(chunks[i]);
+    compressed_bytes += compressed_chunk_memory_usage(compressed_chunks[i]);
+  }
+  auto encode_end = std::chrono::steady_clock::now();
+
+  auto decode_begin = std::chrono::steady_clock::now();
+  for(size_t repeat=0; repeat<DECODE_REPEATS; ++repeat)
+    for(size_t i=0; i<CHUNK_COUNT; ++i)
+    {
+      Chunk chunk = chunk_decompress(compressed_chunks[i]);
+      if(memcmp(chunk.blocks, chunks[i].blocks, CHUNK_SIZE * CHUNK_SIZE * chunk.height) != 0 ||
+         memcmp(chunk.occupancy, chunks[i].occupancy, sizeof(uint64_t) * chunk.height) != 0 ||
+         memcmp(chunk.light, chunks[i].light, CHUNK_SIZE * CHUNK_SIZE * chunk.height) != 0)
+      {
+        fprintf(stderr, "%s: chunk %zu does not survive a round trip\n", name, i);
+        abort();
+      }
+      chunk_destroy(chunk);
+    }
+  auto decode_end = std::chrono::steady_clock::now();
+
+  const double encode_seconds = std::chrono::duration<double>(encode_end - encode_begin).count();
+  const double decode_seconds = std::chrono::duration<double>(decode_end - decode_begin).count() / DECODE_REPEATS;
+
+  printf("%s:\n", name);
+  printf("  blocks            = %zu\n", block_count);
+  printf("  uncompressed size = %zu bytes\n", uncompressed_bytes);
+  printf("  compressed size   = %zu bytes\n", compressed_bytes);
+  printf("  compression ratio = %.2fx\n", (double)uncompressed_bytes / (double)compressed_bytes);
+  printf("  encode throughput = %.1f Mblocks/s\n", block_count / encode_seconds / 1e6);
+  printf("  decode throughput = %.1f Mblocks/s (%.1f MB/s of uncompressed chunk)\n", block_count / decode_seconds / 1e6, uncompressed_bytes / decode_seconds / 1e6);
+
+  for(size_t i=0; i<CHUNK_COUNT; ++i)
+  {
+    chunk_destroy(chunks[i]);
+    compressed_chunk_destroy(compressed_chunks[i]);
+  }
+}
+
+int main()
+{
+  benchmark("random",  chunk_generate_random);
+  benchmark("layered", chunk_generate_layered);
+}
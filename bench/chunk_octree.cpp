@@ -0,0 +1,166 @@
+#include "chunk.hpp"
+#include "chunk_octree.hpp"
+#include "terrain.hpp"
+
+#include <chrono>
+#include <random>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static constexpr size_t CHUNK_COUNT   = 64;
+static constexpr size_t QUERY_COUNT   = 1 << 20;
+static constexpr size_t REGION_COUNT  = 1 << 16;
+static constexpr size_t TALL_HEIGHT   = CHUNK_MAX_HEIGHT;
+
+static Chunk chunk_generate_terrain(unsigned seed)
+{
+  return terrain_generate(0x5eed, glm::ivec2(seed % 8, seed / 8));
+}
+
+// Terrain at the bottom of a chunk as tall as it gets, which is the case the
+// octree is meant for.
+static Chunk chunk_generate_tall(unsigned seed)
+{
+  Chunk terrain = chunk_generate_terrain(seed);
+  Chunk chunk   = chunk_create(TALL_HEIGHT);
+  memcpy(chunk.occupancy, terrain.occupancy, sizeof(uint64_t) * terrain.height);
+  memcpy(chunk.blocks, terrain.blocks, CHUNK_SIZE * CHUNK_SIZE * terrain.height);
+  chunk_destroy(terrain);
+  return chunk;
+}
+
+static bool chunk_region_empty(const Chunk& chunk, glm::ivec3 begin, glm::ivec3 end)
+{
+  for(int z=begin.z; z<end.z; ++z)
+    for(int y=begin.y; y<end.y; ++y)
+      for(int x=begin.x; x<end.x; ++x)
+        if(chunk_is_solid(chunk, x, y, z))
+          return false;
+  return true;
+}
+
+static void benchmark(const char *name, Chunk (*generate)(unsigned seed))
+{
+  Chunk       chunks[CHUNK_COUNT];
+  ChunkOctree octrees[CHUNK_COUNT];
+
+  size_t block_count  = 0;
+  size_t dense_bytes  = 0;
+  size_t octree_bytes = 0;
+  for(size_t i=0; i<CHUNK_COUNT; ++i)
+  {
+    chunks[i] = generate(i);
+    block_count += CHUNK_SIZE * CHUNK_SIZE * chunks[i].height;
+    dense_bytes += chunk_memory_usage(chunks[i]);
+  }
+
+  auto build_begin = std::chrono::steady_clock::now();
+  for(size_t i=0; i<CHUNK_COUNT; ++i)
+  {
+    octrees[i] = chunk_octree_create(chunks[i]);
+    octree_bytes += chunk_octree_memory_usage(octrees[i]);
+  }
+  auto build_end = std::chrono::steady_clock::now();
+
+  for(size_t i=0; i<CHUNK_COUNT; ++i)
+  {
+    Chunk chunk = chunk_octree_expand(octrees[i]);
+    if(memcmp(chunk.blocks, chunks[i].blocks, CHUNK_SIZE * CHUNK_SIZE * chunk.height) != 0 ||
+       memcmp(chunk.occupancy, chunks[i].occupancy, sizeof(uint64_t) * chunk.height) != 0)
+    {
+      fprintf(stderr, "%s: chunk %zu does not survive a round trip\n", name, i);
+      abort();
+    }
+    chunk_destroy(chunk);
+  }
+
+  // The same random blocks are looked up in both layouts
+  std::mt19937 rng(0);
+  struct Query { size_t chunk, x, y, z; };
+  Query *queries = new Query[QUERY_COUNT];
+  for(size_t i=0; i<QUERY_COUNT; ++i)
+  {
+    const size_t chunk = rng() % CHUNK_COUNT;
+    queries[i] = Query{ chunk, rng() % CHUNK_SIZE, rng() % CHUNK_SIZE, rng() % chunks[chunk].height };
+  }
+
+  size_t dense_solid = 0;
+  auto dense_begin = std::chrono::steady_clock::now();
+  for(size_t i=0; i<QUERY_COUNT; ++i)
+    dense_solid += chunk_get_block(chunks[queries[i].chunk], queries[i].x, queries[i].y, queries[i].z) != BlockType::AIR;
+  auto dense_end = std::chrono::steady_clock::now();
+
+  size_t octree_solid = 0;
+  auto octree_begin = std::chrono::steady_clock::now();
+  for(size_t i=0; i<QUERY_COUNT; ++i)
+    octree_solid += chunk_octree_get_block(octrees[queries[i].chunk], queries[i].x, queries[i].y, queries[i].z) != BlockType::AIR;
+  auto octree_end = std::chrono::steady_clock::now();
+
+  if(dense_solid != octree_solid)
+  {
+    fprintf(stderr, "%s: lookups disagree\n", name);
+    abort();
+  }
+  delete[] queries;
+
+  // Random boxes of up to a section in size, checked against a brute force
+  // scan once they have all been timed
+  struct Box { size_t chunk; glm::ivec3 begin, end; };
+  Box    *regions = new Box[REGION_COUNT];
+  bool   *empty   = new bool[REGION_COUNT];
+  for(size_t i=0; i<REGION_COUNT; ++i)
+  {
+    const size_t     chunk = rng() % CHUNK_COUNT;
+    const glm::ivec3 begin = glm::ivec3(rng() % CHUNK_SIZE, rng() % CHUNK_SIZE, rng() % chunks[chunk].height);
+    const glm::ivec3 end   = glm::min(begin + glm::ivec3(1 + rng() % CHUNK_SIZE, 1 + rng() % CHUNK_SIZE, 1 + rng() % CHUNK_SECTION_HEIGHT), glm::ivec3(CHUNK_SIZE, CHUNK_SIZE, chunks[chunk].height));
+    regions[i] = Box{ chunk, begin, end };
+  }
+
+  auto region_begin = std::chrono::steady_clock::now();
+  for(size_t i=0; i<REGION_COUNT; ++i)
+    empty[i] = chunk_octree_is_empty(octrees[regions[i].chunk], regions[i].begin, regions[i].end);
+  auto region_end = std::chrono::steady_clock::now();
+
+  size_t empty_regions = 0;
+  for(size_t i=0; i<REGION_COUNT; ++i)
+  {
+    if(empty[i] != chunk_region_empty(chunks[regions[i].chunk], regions[i].begin, regions[i].end))
+    {
+      fprintf(stderr, "%s: emptiness of region %zu is wrong\n", name, i);
+      abort();
+    }
+    empty_regions += empty[i];
+  }
+  delete[] regions;
+  delete[] empty;
+
+  const double build_seconds  = std::chrono::duration<double>(build_end - build_begin).count();
+  const double dense_seconds  = std::chrono::duration<double>(dense_end - dense_begin).count();
+  const double octree_seconds = std::chrono::duration<double>(octree_end - octree_begin).count();
+  const double region_seconds = std::chrono::duration<double>(region_end - region_begin).count();
+
+  printf("%s:\n", name);
+  printf("  blocks             = %zu\n", block_count);
+  printf("  dense size         = %zu bytes\n", dense_bytes);
+  printf("  octree size        = %zu bytes\n", octree_bytes);
+  printf("  size ratio         = %.2fx\n", (double)dense_bytes / (double)octree_bytes);
+  printf("  build throughput   = %.1f Mblocks/s\n", block_count / build_seconds / 1e6);
+  printf("  dense lookups      = %.1f Mlookups/s\n", QUERY_COUNT / dense_seconds / 1e6);
+  printf("  octree lookups     = %.1f Mlookups/s\n", QUERY_COUNT / octree_seconds / 1e6);
+  printf("  region queries     = %.1f Mqueries/s (%zu of %zu empty)\n", REGION_COUNT / region_seconds / 1e6, empty_regions, REGION_COUNT);
+
+  for(size_t i=0; i<CHUNK_COUNT; ++i)
+  {
+    chunk_destroy(chunks[i]);
+    chunk_octree_destroy(octrees[i]);
+  }
+}
+
+int main()
+{
+  benchmark("random",  chunk_generate_random);
+  benchmark("terrain", chunk_generate_terrain);
+  benchmark("tall",    chunk_generate_tall);
+}
@@ -0,0 +1,142 @@
+#include "chunk_world.hpp"
+#include "terrain.hpp"
+
+#include <chrono>
+#include <random>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static constexpr uint32_t  SEED        = 0x5eed;
+static constexpr size_t    BOX_COUNT   = 1024;
+static constexpr size_t    FRAME_COUNT = 256;
+static constexpr glm::vec3 HALF_EXTENT = glm::vec3(0.12f);
+static constexpr float     GRAVITY     = BLOCK_WIDTH; // Per frame, in world units
+
+// Chunks are set up by hand in the slots they would end up in, since
+// chunk_world_init needs a Vulkan context and the sweep never touches
+// anything but the slots.
+static ChunkSlot& world_slot(ChunkWorld& world, glm::ivec2 coord)
+{
+  const int width = CHUNK_WORLD_WIDTH;
+  const int x = ((coord.x % width) + width) % width;
+  const int y = ((coord.y % width) + width) % width;
+  return world.slots[y * width + x];
+}
+
+static void world_create(ChunkWorld& world, bool compressed)
+{
+  world.center = glm::ivec2(0, 0);
+  for(int y=-CHUNK_WORLD_RADIUS; y<=CHUNK_WORLD_RADIUS; ++y)
+    for(int x=-CHUNK_WORLD_RADIUS; x<=CHUNK_WORLD_RADIUS; ++x)
+    {
+      ChunkSlot& slot = world_slot(world, glm::ivec2(x, y));
+      slot.state = ChunkSlotState::READY;
+      slot.coord = glm::ivec2(x, y);
+      slot.chunk = terrain_generate(SEED, slot.coord);
+      if(compressed)
+      {
+        slot.compressed_chunk = chunk_compress(slot.chunk);
+        slot.compressed       = true;
+        chunk_destroy(slot.chunk);
+        slot.chunk = {};
+      }
+    }
+}
+
+static void world_destroy(ChunkWorld& world)
+{
+  for(ChunkSlot& slot : world.slots)
+  {
+    if(slot.state != ChunkSlotState::READY)
+      continue;
+
+    if(slot.compressed)
+      compressed_chunk_destroy(slot.compressed_chunk);
+    else
+      chunk_destroy(slot.chunk);
+    slot = {};
+  }
+}
+
+// Boxes dropped from above the terrain and wandering around the world,
+// roughly what entities do every update.
+static double benchmark(const ChunkWorld& world, glm::vec3 *positions, size_t& hits)
+{
+  std::mt19937 rng(SEED);
+  const float extent = CHUNK_WORLD_RADIUS * CHUNK_SIZE * BLOCK_WIDTH;
+  std::uniform_real_distribution<float> horizontal(-extent, extent);
+  std::uniform_real_distribution<float> wander(-0.05f, 0.05f);
+
+  for(size_t i=0; i<BOX_COUNT; ++i)
+    positions[i] = glm::vec3(horizontal(rng), horizontal(rng), TERRAIN_HEIGHT * BLOCK_WIDTH);
+
+  hits = 0;
+  auto begin = std::chrono::steady_clock::now();
+  for(size_t frame=0; frame<FRAME_COUNT; ++frame)
+    for(size_t i=0; i<BOX_COUNT; ++i)
+    {
+      const glm::vec3 displacement = glm::vec3(wander(rng), wander(rng), -GRAVITY);
+      positions[i] += chunk_world_sweep_box(world, positions[i] - HALF_EXTENT, positions[i] + HALF_EXTENT, displacement);
+
+      ChunkRaycastHit hit;
+      hits += chunk_world_raycast(world, positions[i], glm::vec3(0.0f, 0.0f, -1.0f), 1.0f, hit);
+    }
+  auto end = std::chrono::steady_clock::now();
+
+  return std::chrono::duration<double>(end - begin).count();
+}
+
+int main()
+{
+  static ChunkWorld dense_world;
+  static ChunkWorld compressed_world;
+  world_create(dense_world, false);
+  world_create(compressed_world, true);
+
+  // Remember the runs of every compressed chunk to catch them being
+  // decompressed and compressed again behind our back
+  const uint8_t *runs[CHUNK_WORLD_WIDTH * CHUNK_WORLD_WIDTH];
+  for(size_t i=0; i<CHUNK_WORLD_WIDTH * CHUNK_WORLD_WIDTH; ++i)
+    runs[i] = data(compressed_world.slots[i].compressed_chunk.runs);
+
+  static glm::vec3 dense_positions[BOX_COUNT];
+  static glm::vec3 compressed_positions[BOX_COUNT];
+  size_t dense_hits;
+  size_t compressed_hits;
+  const double dense_seconds      = benchmark(dense_world, dense_positions, dense_hits);
+  const double compressed_seconds = benchmark(compressed_world, compressed_positions, compressed_hits);
+
+  for(size_t i=0; i<BOX_COUNT; ++i)
+    if(dense_positions[i] != compressed_positions[i])
+    {
+      fprintf(stderr, "Box %zu ended up somewhere else in the compressed world\n", i);
+      abort();
+    }
+
+  if(dense_hits != compressed_hits)
+  {
+    fprintf(stderr, "Raycasts hit %zu blocks in the compressed world instead of %zu\n", compressed_hits, dense_hits);
+    abort();
+  }
+
+  for(size_t i=0; i<CHUNK_WORLD_WIDTH * CHUNK_WORLD_WIDTH; ++i)
+  {
+    const ChunkSlot& slot = compressed_world.slots[i];
+    if(slot.state == ChunkSlotState::READY && (!slot.compressed || data(slot.compressed_chunk.runs) != runs[i]))
+    {
+      fprintf(stderr, "Chunk %d,%d was decompressed by a sweep\n", slot.coord.x, slot.coord.y);
+      abort();
+    }
+  }
+
+  const size_t sweep_count = BOX_COUNT * FRAME_COUNT;
+  printf("chunk_world_sweep:\n");
+  printf("  sweeps and raycasts = %zu\n", sweep_count);
+  printf("  raycast hits        = %zu\n", dense_hits);
+  printf("  dense               = %.1f ns per sweep and raycast\n", dense_seconds / sweep_count * 1e9);
+  printf("  compressed          = %.1f ns per sweep and raycast, no chunk decompressed\n", compressed_seconds / sweep_count * 1e9);
+
+  world_destroy(dense_world);
+  world_destroy(compressed_world);
+}
@@ -0,0 +1,140 @@
+#include "chunk.hpp"
+#include "terrain.hpp"
+#include "resources/mesh_optimizer.hpp"
+#include "resources/obj.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include <math.h>
+#include <stdio.h>
+
+static constexpr int    SPHERE_RINGS    = 256;
+static constexpr int    SPHERE_SEGMENTS = 512;
+static constexpr size_t CHUNK_COUNT     = 64;
+
+// UV sphere with its triangles shuffled, the worst case for the vertex
+// cache, used when no file is given.
+static void generate_sphere(std::vector<vulkan::Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+  for(int ring=0; ring<=SPHERE_RINGS; ++ring)
+    for(int segment=0; segment<=SPHERE_SEGMENTS; ++segment)
+    {
+      const float theta = M_PI * ring / SPHERE_RINGS;
+      const float phi   = 2.0f * M_PI * segment / SPHERE_SEGMENTS;
+
+      vulkan::Vertex vertex = {};
+      vertex.pos    = glm::vec3(sinf(theta) * cosf(phi), sinf(theta) * sinf(phi), cosf(theta));
+      vertex.normal = vertex.pos;
+      vertices.push_back(vertex);
+    }
+
+  std::vector<uint32_t> triangles;
+  const uint32_t row = SPHERE_SEGMENTS + 1;
+  for(uint32_t ring=0; ring<SPHERE_RINGS; ++ring)
+    for(uint32_t segment=0; segment<SPHERE_SEGMENTS; ++segment)
+    {
+      const uint32_t i = ring * row + segment;
+      triangles.push_back(i);
+      triangles.push_back(i + 1);
+      triangles.push_back(i + row + 1);
+      triangles.push_back(i);
+      triangles.push_back(i + row + 1);
+      triangles.push_back(i + row);
+    }
+
+  std::vector<uint32_t> order(triangles.size() / 3);
+  for(uint32_t i=0; i<order.size(); ++i)
+    order[i] = i;
+  std::shuffle(order.begin(), order.end(), std::mt19937(0x5eed));
+
+  for(uint32_t triangle : order)
+    for(uint32_t corner=0; corner<3; ++corner)
+      indices.push_back(triangles[triangle * 3 + corner]);
+}
+
+static void print_statistics(const char *stage, const std::vector<vulkan::Vertex>& vertices, const std::vector<uint32_t>& indices, double seconds)
+{
+  const vulkan::VertexCacheStatistics statistics = vulkan::mesh_analyze_vertex_cache(indices.data(), indices.size(), vertices.size());
+  printf("  %-13s = ACMR %.3f, ATVR %.3f (%.1f ms)\n", stage, statistics.acmr, statistics.atvr, seconds * 1e3);
+}
+
+// Run each stage of what mesh_load does to an OBJ mesh in turn
+static void benchmark(const char *name, std::vector<vulkan::Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+  printf("%s:\n", name);
+  printf("  vertices      = %zu\n", vertices.size());
+  printf("  triangles     = %zu\n", indices.size() / 3);
+  if(indices.empty())
+    return;
+
+  const vulkan::VertexCacheStatistics original = vulkan::mesh_analyze_vertex_cache(indices.data(), indices.size(), vertices.size());
+  printf("  original      = ACMR %.3f, ATVR %.3f\n", original.acmr, original.atvr);
+
+  auto begin = std::chrono::steady_clock::now();
+  vulkan::mesh_optimize_vertex_cache(indices.data(), indices.size(), vertices.size());
+  auto end = std::chrono::steady_clock::now();
+  print_statistics("vertex cache", vertices, indices, std::chrono::duration<double>(end - begin).count());
+
+  begin = std::chrono::steady_clock::now();
+  vulkan::mesh_optimize_overdraw(indices.data(), indices.size(), &vertices[0].pos.x, sizeof(vulkan::Vertex), vertices.size());
+  end = std::chrono::steady_clock::now();
+  print_statistics("overdraw", vertices, indices, std::chrono::duration<double>(end - begin).count());
+
+  begin = std::chrono::steady_clock::now();
+  vertices.resize(vulkan::mesh_optimize_vertex_fetch(vertices.data(), sizeof(vulkan::Vertex), vertices.size(), indices.data(), indices.size()));
+  end = std::chrono::steady_clock::now();
+  print_statistics("vertex fetch", vertices, indices, std::chrono::duration<double>(end - begin).count());
+}
+
+// Chunk meshes are already ordered section by section as they are generated,
+// so only report how well that does.
+static void benchmark_chunks()
+{
+  size_t vertex_count   = 0;
+  size_t triangle_count = 0;
+  float  acmr           = 0.0f;
+  float  atvr           = 0.0f;
+  for(size_t i=0; i<CHUNK_COUNT; ++i)
+  {
+    Chunk         chunk     = terrain_generate(0x5eed, glm::ivec2(i % 8, i / 8));
+    ChunkMeshData mesh_data = chunk_generate_mesh_data(chunk, ChunkNeighbours{}, ChunkMeshMode::GREEDY);
+
+    const vulkan::VertexCacheStatistics statistics = vulkan::mesh_analyze_vertex_cache(data(mesh_data.indices), size(mesh_data.indices), size(mesh_data.vertices));
+    vertex_count   += size(mesh_data.vertices);
+    triangle_count += size(mesh_data.indices) / 3;
+    acmr           += statistics.acmr * size(mesh_data.indices) / 3;
+    atvr           += statistics.atvr * size(mesh_data.vertices);
+
+    chunk_mesh_data_destroy(mesh_data);
+    chunk_destroy(chunk);
+  }
+
+  printf("terrain chunks:\n");
+  printf("  vertices      = %zu\n", vertex_count);
+  printf("  triangles     = %zu\n", triangle_count);
+  printf("  meshed        = ACMR %.3f, ATVR %.3f\n", acmr / triangle_count, atvr / vertex_count);
+}
+
+int main(int argc, char **argv)
+{
+  if(argc > 1)
+  {
+    for(int i=1; i<argc; ++i)
+    {
+      std::vector<vulkan::Vertex> vertices;
+      std::vector<uint32_t>       indices;
+      vulkan::obj_parse(argv[i], vertices, indices);
+      benchmark(argv[i], vertices, indices);
+    }
+    return 0;
+  }
+
+  std::vector<vulkan::Vertex> vertices;
+  std::vector<uint32_t>       indices;
+  generate_sphere(vertices, indices);
+  benchmark("shuffled sphere", vertices, indices);
+  benchmark_chunks();
+}
@@ -0,0 +1,126 @@
+#include "resources/obj.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Side of the grid of quads generated when no file is given, which gives a
+// file of about 75 MB
+static constexpr int GRID_SIZE = 640;
+
+// Rolling terrain made of quads, with every record type obj_parse reads and
+// a mix of absolute and relative indices, so that both parsers have real
+// work to do.
+static void generate_grid(const char *file_name)
+{
+  FILE *file = fopen(file_name, "w");
+  if(!file)
+  {
+    perror(file_name);
+    abort();
+  }
+
+  fprintf(file, "# %dx%d grid\no grid\n", GRID_SIZE, GRID_SIZE);
+  for(int y=0; y<=GRID_SIZE; ++y)
+    for(int x=0; x<=GRID_SIZE; ++x)
+    {
+      const float height = 0.25f * sinf(x * 0.05f) * cosf(y * 0.07f);
+      fprintf(file, "v %f %f %f\n", x * 0.01f, y * 0.01f, height);
+      fprintf(file, "vt %f %f\n", (float)x / GRID_SIZE, (float)y / GRID_SIZE);
+      fprintf(file, "vn %f %f %f\n", -0.0125f * cosf(x * 0.05f), 0.0175f * sinf(y * 0.07f), 1.0f);
+    }
+
+  const int row = GRID_SIZE + 1;
+  const int count = row * row;
+  for(int y=0; y<GRID_SIZE; ++y)
+    for(int x=0; x<GRID_SIZE; ++x)
+    {
+      const int i[4] = { y * row + x + 1, y * row + x + 2, (y + 1) * row + x + 2, (y + 1) * row + x + 1 };
+      if((x + y) % 2 == 0)
+        fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", i[0], i[0], i[0], i[1], i[1], i[1], i[2], i[2], i[2], i[3], i[3], i[3]);
+      else
+        fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d\nf %d/%d/%d %d/%d/%d %d/%d/%d\n",
+            i[0] - count - 1, i[0], i[0], i[1] - count - 1, i[1], i[1], i[2] - count - 1, i[2], i[2],
+            i[0], i[0], i[0], i[2], i[2], i[2], i[3], i[3], i[3]);
+    }
+
+  fclose(file);
+}
+
+static void benchmark(const char *file_name)
+{
+  struct stat st;
+  if(stat(file_name, &st) != 0)
+  {
+    perror(file_name);
+    abort();
+  }
+  const double megabytes = st.st_size / 1e6;
+
+  std::vector<vulkan::Vertex> reference_vertices;
+  std::vector<uint32_t>       reference_indices;
+  auto reference_begin = std::chrono::steady_clock::now();
+  vulkan::obj_parse_tinyobj(file_name, reference_vertices, reference_indices);
+  auto reference_end = std::chrono::steady_clock::now();
+  const double reference_seconds = std::chrono::duration<double>(reference_end - reference_begin).count();
+
+  printf("%s:\n", file_name);
+  printf("  size               = %.1f MB\n", megabytes);
+  printf("  vertices           = %zu\n", reference_vertices.size());
+  printf("  indices            = %zu\n", reference_indices.size());
+  printf("  tinyobj            = %.1f MB/s\n", megabytes / reference_seconds);
+
+  // Doubling the number of threads up to one per hardware thread
+  const size_t hardware_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  for(size_t thread_count = 1;; thread_count = std::min(2 * thread_count, hardware_threads))
+  {
+    std::vector<vulkan::Vertex> vertices;
+    std::vector<uint32_t>       indices;
+    auto begin = std::chrono::steady_clock::now();
+    vulkan::obj_parse(file_name, vertices, indices, thread_count);
+    auto end = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(end - begin).count();
+
+    if(vertices.size() != reference_vertices.size() || indices != reference_indices
+    || memcmp(vertices.data(), reference_vertices.data(), vertices.size() * sizeof(vulkan::Vertex)) != 0)
+    {
+      fprintf(stderr, "%s: obj_parse with %zu threads disagree with tinyobj\n", file_name, thread_count);
+      abort();
+    }
+
+    printf("  obj_parse %2zu threads = %.1f MB/s (%.1fx)\n", thread_count, megabytes / seconds, reference_seconds / seconds);
+    if(thread_count == hardware_threads)
+      break;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  if(argc > 1)
+  {
+    for(int i=1; i<argc; ++i)
+      benchmark(argv[i]);
+    return 0;
+  }
+
+  char file_name[] = "/tmp/bench_obj_parse_XXXXXX";
+  const int fd = mkstemp(file_name);
+  if(fd < 0)
+  {
+    perror("mkstemp");
+    abort();
+  }
+  close(fd);
+
+  generate_grid(file_name);
+  benchmark(file_name);
+  unlink(file_name);
+}
@@ -0,0 +1,84 @@
+#include "chunk.hpp"
+#include "terrain.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static constexpr size_t   CHUNK_WIDTH = 32; // Chunks generated along each axis
+static constexpr size_t   CHUNK_COUNT = CHUNK_WIDTH * CHUNK_WIDTH;
+static constexpr uint32_t SEED        = 0x5eed;
+
+static glm::ivec2 chunk_coord(size_t i)
+{
+  // Centered on the origin so that negative coordinates are covered too
+  return glm::ivec2((int)(i % CHUNK_WIDTH) - (int)CHUNK_WIDTH / 2, (int)(i / CHUNK_WIDTH) - (int)CHUNK_WIDTH / 2);
+}
+
+// Generate every chunk using thread_count threads, each taking every
+// thread_count-th chunk, and return the time taken in seconds.
+static double generate(Chunk *chunks, size_t thread_count)
+{
+  auto work = [&](size_t first) {
+    for(size_t i=first; i<CHUNK_COUNT; i+=thread_count)
+      chunks[i] = terrain_generate(SEED, chunk_coord(i));
+  };
+
+  auto begin = std::chrono::steady_clock::now();
+  std::thread *threads = new std::thread[thread_count];
+  for(size_t i=0; i<thread_count; ++i)
+    threads[i] = std::thread(work, i);
+  for(size_t i=0; i<thread_count; ++i)
+    threads[i].join();
+  delete[] threads;
+  auto end = std::chrono::steady_clock::now();
+
+  return std::chrono::duration<double>(end - begin).count();
+}
+
+int main()
+{
+  static Chunk reference[CHUNK_COUNT];
+  static Chunk chunks[CHUNK_COUNT];
+
+  const double reference_seconds = generate(reference, 1);
+  const size_t block_count       = CHUNK_COUNT * CHUNK_SIZE * CHUNK_SIZE * TERRAIN_HEIGHT;
+
+  printf("terrain:\n");
+  printf("  chunks = %zu\n", CHUNK_COUNT);
+  printf("  blocks = %zu\n", block_count);
+  printf("  1 thread (reference) = %.1f Mblocks/s\n", block_count / reference_seconds / 1e6);
+
+  const size_t hardware_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  // Doubling the thread count each time up to the number of hardware threads
+  for(size_t thread_count=1;; thread_count=std::min(thread_count * 2, hardware_threads))
+  {
+    const double seconds = generate(chunks, thread_count);
+
+    // The output must not depend on which thread generated which chunk
+    for(size_t i=0; i<CHUNK_COUNT; ++i)
+    {
+      if(chunks[i].height != reference[i].height ||
+         memcmp(chunks[i].blocks, reference[i].blocks, CHUNK_SIZE * CHUNK_SIZE * chunks[i].height) != 0 ||
+         memcmp(chunks[i].occupancy, reference[i].occupancy, sizeof(uint64_t) * chunks[i].height) != 0)
+      {
+        fprintf(stderr, "terrain: chunk %zu differs when generated with %zu threads\n", i, thread_count);
+        abort();
+      }
+      chunk_destroy(chunks[i]);
+    }
+
+    printf("  %zu thread%s = %.1f Mblocks/s (%.2fx)\n", thread_count, thread_count == 1 ? "" : "s",
+      block_count / seconds / 1e6, reference_seconds / seconds);
+
+    if(thread_count == hardware_threads)
+      break;
+  }
+
+  for(size_t i=0; i<CHUNK_COUNT; ++i)
+    chunk_destroy(reference[i]);
+}
@@ -1,3 +1,4 @@
 #!/bin/sh
 glslc shaders/shader.vert -o shaders/vert.spv
 glslc shaders/shader.frag -o shaders/frag.spv
+glslc shaders/voxel.vert -o shaders/voxel_vert.spv
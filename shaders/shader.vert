@@ -5,25 +5,35 @@ layout(push_constant) uniform UniformBufferObject {
     mat4 model;
 } matrices;
 
-layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inNormal;
-layout(location = 2) in vec3 inColor;
-layout(location = 3) in vec2 inUV;
+// Quantized vertices from src/resources/mesh.hpp. Positions are in [0, 1]
+// and brought back into model space by the model matrix, normals are
+// octahedral encoded and vertex colors are dropped.
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in vec2 inNormal;
+layout(location = 2) in vec2 inUV;
 
 layout(location = 0) out vec3 fragNormal;
 layout(location = 1) out vec3 fragColor;
 layout(location = 2) out vec2 fragUV;
 layout(location = 3) out vec3 fragPos;
 
+vec3 octahedral_decode(vec2 e) {
+    vec3  n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
 void main() {
     mat4 mvp_matrix    = matrices.mvp;
     mat4 model_matrix  = matrices.model;
     mat3 normal_matrix = mat3(transpose(inverse(model_matrix)));
 
-    gl_Position = mvp_matrix * vec4(inPosition, 1.0);
+    gl_Position = mvp_matrix * vec4(inPosition.xyz, 1.0);
 
-    fragNormal = normal_matrix * inNormal;
-    fragColor  = inColor;
+    fragNormal = normalize(normal_matrix * octahedral_decode(inNormal));
+    fragColor  = vec3(1.0);
     fragUV     = inUV;
-    fragPos    = vec3(model_matrix * vec4(inPosition, 1.0));
+    fragPos    = vec3(model_matrix * vec4(inPosition.xyz, 1.0));
 }
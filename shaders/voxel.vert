@@ -0,0 +1,72 @@
+#version 450
+
+// Variant of shader.vert for chunk meshes, which use the packed VoxelVertex
+// from src/chunk.hpp instead of vulkan::Vertex.
+
+layout(push_constant) uniform UniformBufferObject {
+    mat4 mvp;
+    mat4 model;
+} matrices;
+
+layout(location = 0) in uint inPosition;
+layout(location = 1) in uint inAttributes;
+
+layout(location = 0) out vec3 fragNormal;
+layout(location = 1) out vec3 fragColor;
+layout(location = 2) out vec2 fragUV;
+layout(location = 3) out vec3 fragPos;
+
+const float BLOCK_WIDTH = 0.2;
+
+// Indexed by face direction, ordered -X, +X, -Y, +Y, -Z, +Z
+const vec3 NORMALS[6] = vec3[](
+    vec3(-1.0,  0.0,  0.0),
+    vec3( 1.0,  0.0,  0.0),
+    vec3( 0.0, -1.0,  0.0),
+    vec3( 0.0,  1.0,  0.0),
+    vec3( 0.0,  0.0, -1.0),
+    vec3( 0.0,  0.0,  1.0)
+);
+
+// Indexed by BlockType
+const vec3 BLOCK_TYPE_COLORS[7] = vec3[](
+    vec3(0.00, 0.00, 0.00), // AIR
+    vec3(0.50, 0.50, 0.50), // STONE
+    vec3(0.45, 0.30, 0.15), // DIRT
+    vec3(0.30, 0.65, 0.20), // GRASS
+    vec3(0.90, 0.85, 0.55), // SAND
+    vec3(0.95, 0.95, 1.00), // SNOW
+    vec3(1.00, 0.90, 0.60)  // LAMP
+);
+
+// Brightness for each level of ambient occlusion, from none to fully occluded
+const float AMBIENT_OCCLUSION_FACTORS[4] = float[](1.0, 0.8, 0.6, 0.45);
+
+// Brightness lost for every level of light below the maximum of 15
+const float LIGHT_FALLOFF = 0.8;
+
+void main() {
+    vec3 position = vec3(
+        bitfieldExtract(inPosition, 0,  8),
+        bitfieldExtract(inPosition, 8,  8),
+        bitfieldExtract(inPosition, 16, 16)
+    ) * BLOCK_WIDTH;
+
+    uint direction         = bitfieldExtract(inAttributes, 0, 3);
+    uint ambient_occlusion = bitfieldExtract(inAttributes, 3, 2);
+    uint block_type        = bitfieldExtract(inAttributes, 5, 8);
+    uint block_light       = bitfieldExtract(inAttributes, 13, 4);
+    uint sky_light         = bitfieldExtract(inAttributes, 17, 4);
+    float light            = pow(LIGHT_FALLOFF, float(15 - max(block_light, sky_light)));
+
+    mat4 mvp_matrix   = matrices.mvp;
+    mat4 model_matrix = matrices.model;
+
+    gl_Position = mvp_matrix * vec4(position, 1.0);
+
+    // Chunks are only ever translated so the normal need no transform
+    fragNormal = NORMALS[direction];
+    fragColor  = BLOCK_TYPE_COLORS[block_type] * AMBIENT_OCCLUSION_FACTORS[ambient_occlusion] * light;
+    fragUV     = vec2(0.0);
+    fragPos    = vec3(model_matrix * vec4(position, 1.0));
+}
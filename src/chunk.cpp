@@ -0,0 +1,913 @@
+#include "chunk.hpp"
+
+#include "resources/mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <utility>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+Chunk chunk_create(size_t height)
+{
+  assert(height <= CHUNK_MAX_HEIGHT);
+
+  Chunk chunk = {};
+  chunk.height    = height;
+  chunk.occupancy = new uint64_t[height]();
+  chunk.blocks    = new BlockType[CHUNK_SIZE * CHUNK_SIZE * height]();
+  chunk.light     = new uint8_t[CHUNK_SIZE * CHUNK_SIZE * height]();
+  return chunk;
+}
+
+Chunk chunk_generate_random(unsigned seed)
+{
+  srand(seed);
+
+  Chunk chunk = chunk_create((size_t)rand() % 256);
+  for(size_t z=0; z<chunk.height; ++z)
+    for(size_t y=0; y<CHUNK_SIZE; ++y)
+      for(size_t x=0; x<CHUNK_SIZE; ++x)
+        if((unsigned)rand() % 8 == 0)
+        {
+          // Band the block types by height like the old color gradient
+          const size_t type = 1 + z * (size_t)BlockType::SNOW / chunk.height;
+          chunk_set_block(chunk, x, y, z, (BlockType)type);
+        }
+
+  return chunk;
+}
+
+void chunk_destroy(const Chunk& chunk)
+{
+  delete[] chunk.occupancy;
+  delete[] chunk.blocks;
+  delete[] chunk.light;
+}
+
+void chunk_set_block(Chunk& chunk, size_t x, size_t y, size_t z, BlockType type)
+{
+  assert(x < CHUNK_SIZE && y < CHUNK_SIZE && z < chunk.height);
+
+  const size_t i = chunk_block_index(x, y, z);
+  if(chunk.blocks[i] == type)
+    return;
+
+  const uint64_t bit = uint64_t(1) << (y * CHUNK_SIZE + x);
+  if(type != BlockType::AIR)
+    chunk.occupancy[z] |= bit;
+  else
+    chunk.occupancy[z] &= ~bit;
+
+  chunk.blocks[i] = type;
+  chunk_mark_dirty(chunk, z);
+}
+
+static constexpr uint64_t HASH_K = 0x9e3779b97f4a7c15;
+
+// One multiply per 8 bytes, with the high bits folded back in so that every
+// byte end up affecting every bit of the result
+static uint64_t hash_words(uint64_t hash, const void *bytes, size_t word_count)
+{
+  for(size_t i=0; i<word_count; ++i)
+  {
+    uint64_t word;
+    memcpy(&word, (const uint8_t *)bytes + i * sizeof(uint64_t), sizeof word);
+    hash = (hash ^ word) * HASH_K;
+    hash ^= hash >> 32;
+  }
+  return hash;
+}
+
+uint64_t chunk_hash(const Chunk& chunk)
+{
+  static_assert(CHUNK_SIZE * CHUNK_SIZE % sizeof(uint64_t) == 0);
+
+  uint64_t hash = chunk.height * HASH_K;
+  const size_t word_count = CHUNK_SIZE * CHUNK_SIZE * chunk.height / sizeof(uint64_t);
+  hash = hash_words(hash, chunk.blocks, word_count);
+  hash = hash_words(hash, chunk.light, word_count);
+  return hash;
+}
+
+static constexpr uint64_t LAYER_ROW_FIRST = 0xff; // Bits with y == 0
+static constexpr uint64_t LAYER_ROW_LAST  = LAYER_ROW_FIRST << (CHUNK_SIZE * (CHUNK_SIZE - 1)); // Bits with y == CHUNK_SIZE - 1
+
+ChunkBorder chunk_border_create(const Chunk& neighbour, size_t direction)
+{
+  assert(direction < 4);
+
+  // The side of the neighbour facing back toward the chunk
+  static constexpr uint64_t masks[4] = { LAYER_COLUMN_LAST, LAYER_COLUMN_FIRST, LAYER_ROW_LAST, LAYER_ROW_FIRST };
+
+  ChunkBorder border = {};
+  border.height    = neighbour.height;
+  border.occupancy = new uint64_t[neighbour.height];
+  border.light     = new uint8_t[CHUNK_SIZE * neighbour.height];
+  for(size_t z=0; z<neighbour.height; ++z)
+  {
+    border.occupancy[z] = neighbour.occupancy[z] & masks[direction];
+    for(size_t i=0; i<CHUNK_SIZE; ++i)
+    {
+      const size_t x = direction / 2 == 0 ? (direction == 0 ? CHUNK_SIZE - 1 : 0) : i;
+      const size_t y = direction / 2 == 1 ? (direction == 2 ? CHUNK_SIZE - 1 : 0) : i;
+      border.light[z * CHUNK_SIZE + i] = chunk_get_light(neighbour, x, y, z);
+    }
+  }
+  return border;
+}
+
+void chunk_border_destroy(ChunkBorder& border)
+{
+  delete[] border.occupancy;
+  delete[] border.light;
+  border = {};
+}
+
+void chunk_neighbours_destroy(ChunkNeighbours& neighbours)
+{
+  for(ChunkBorder& border : neighbours.borders)
+    chunk_border_destroy(border);
+}
+
+uint32_t chunk_neighbours_sides(const ChunkNeighbours& neighbours)
+{
+  uint32_t sides = 0;
+  for(size_t direction=0; direction<4; ++direction)
+    if(neighbours.borders[direction].occupancy)
+      sides |= 1u << direction;
+  return sides;
+}
+
+uint64_t chunk_neighbours_hash(const ChunkNeighbours& neighbours)
+{
+  static_assert(CHUNK_SIZE % sizeof(uint64_t) == 0);
+
+  uint64_t hash = chunk_neighbours_sides(neighbours) * HASH_K;
+  for(const ChunkBorder& border : neighbours.borders)
+  {
+    hash = hash_words(hash, &border.height, 1);
+    hash = hash_words(hash, border.occupancy, border.height);
+    hash = hash_words(hash, border.light, CHUNK_SIZE * border.height / sizeof(uint64_t));
+  }
+  return hash;
+}
+
+Chunk chunk_downsample(const Chunk& chunk, size_t level)
+{
+  assert(level < CHUNK_LOD_COUNT);
+
+  Chunk result = chunk_create(chunk.height);
+  if(level == 0)
+  {
+    memcpy(result.occupancy, chunk.occupancy, sizeof(uint64_t) * chunk.height);
+    memcpy(result.blocks, chunk.blocks, CHUNK_SIZE * CHUNK_SIZE * chunk.height);
+    return result;
+  }
+
+  const size_t cube = size_t(1) << level;
+  for(size_t cz=0; cz<chunk.height; cz+=cube)
+    for(size_t cy=0; cy<CHUNK_SIZE; cy+=cube)
+      for(size_t cx=0; cx<CHUNK_SIZE; cx+=cube)
+      {
+        // The top cubes are cut short if the height is not a multiple of the size
+        const size_t cz_end = std::min(cz + cube, chunk.height);
+
+        size_t solid = 0;
+        size_t type_counts[(size_t)BlockType::COUNT] = {};
+        bool   top_found = false;
+        for(size_t z=cz_end; z-->cz;)
+        {
+          size_t layer_solid = 0;
+          for(size_t y=cy; y<cy+cube; ++y)
+            for(size_t x=cx; x<cx+cube; ++x)
+              if(chunk_is_solid(chunk, x, y, z))
+              {
+                ++layer_solid;
+                if(!top_found)
+                  ++type_counts[(size_t)chunk_get_block(chunk, x, y, z)];
+              }
+
+          solid     += layer_solid;
+          top_found |= layer_solid != 0;
+        }
+
+        if(solid * 2 < cube * cube * (cz_end - cz))
+          continue;
+
+        size_t type = 1;
+        for(size_t t=2; t<(size_t)BlockType::COUNT; ++t)
+          if(type_counts[t] > type_counts[type])
+            type = t;
+
+        for(size_t z=cz; z<cz_end; ++z)
+          for(size_t y=cy; y<cy+cube; ++y)
+            for(size_t x=cx; x<cx+cube; ++x)
+              chunk_set_block(result, x, y, z, (BlockType)type);
+      }
+
+  result.dirty_sections = 0;
+  return result;
+}
+
+size_t chunk_memory_usage(const Chunk& chunk)
+{
+  return chunk.height * (sizeof(uint64_t) + CHUNK_SIZE * CHUNK_SIZE * (sizeof(BlockType) + sizeof(uint8_t)));
+}
+
+static_assert((size_t)BlockType::COUNT == 7, "Update BLOCK_TYPE_COLORS in shaders/voxel.vert");
+
+static constexpr vulkan::VertexAttributeDescription VOXEL_VERTEX_ATTRIBUTE_DESCRIPTIONS[] = {
+  { .offset = offsetof(VoxelVertex, position),   .type = vulkan::VertexAttributeDescription::Type::UINT1 },
+  { .offset = offsetof(VoxelVertex, attributes), .type = vulkan::VertexAttributeDescription::Type::UINT1 },
+};
+
+static constexpr vulkan::VertexBindingDescription VOXEL_VERTEX_BINDING_DESCRIPTIONS[] = {{
+  .stride          = sizeof(VoxelVertex),
+  .attributes      = VOXEL_VERTEX_ATTRIBUTE_DESCRIPTIONS,
+  .attribute_count = std::size(VOXEL_VERTEX_ATTRIBUTE_DESCRIPTIONS),
+}};
+
+static constexpr vulkan::MeshLayoutDescription VOXEL_MESH_LAYOUT_DESCRIPTION = {
+  .vertex_layout = {
+    .bindings      = VOXEL_VERTEX_BINDING_DESCRIPTIONS,
+    .binding_count = std::size(VOXEL_VERTEX_BINDING_DESCRIPTIONS),
+  },
+};
+
+vulkan::mesh_layout_t voxel_mesh_layout_create()
+{
+  return vulkan::mesh_layout_compile(&VOXEL_MESH_LAYOUT_DESCRIPTION);
+}
+
+// Faces are ordered -X, +X, -Y, +Y, -Z, +Z so that direction / 2 is the axis
+// and direction % 2 is whether the face points toward the positive side.
+static constexpr size_t DIRECTION_COUNT = 6;
+
+// Layer z of the border in direction, or nothing but air if z is outside of
+// it or the neighbour is missing.
+static uint64_t chunk_border_layer(const ChunkNeighbours& neighbours, size_t direction, int z)
+{
+  const ChunkBorder& border = neighbours.borders[direction];
+  return z >= 0 && (size_t)z < border.height ? border.occupancy[z] : 0;
+}
+
+// Compute for layer z the mask of blocks whose face in direction is exposed.
+// The blocks along a border are moved to the opposite side of the layer to
+// cover the faces of the chunk they touch.
+static uint64_t chunk_exposed_faces(const Chunk& chunk, const ChunkNeighbours& neighbours, size_t z, size_t direction)
+{
+  const uint64_t *layers = chunk.occupancy;
+  const uint64_t  layer  = layers[z];
+  switch(direction)
+  {
+  case 0: return layer & ~(((layer << 1) & ~LAYER_COLUMN_FIRST) | chunk_border_layer(neighbours, 0, z) >> (CHUNK_SIZE - 1));
+  case 1: return layer & ~(((layer >> 1) & ~LAYER_COLUMN_LAST)  | chunk_border_layer(neighbours, 1, z) << (CHUNK_SIZE - 1));
+  case 2: return layer & ~((layer << CHUNK_SIZE) | chunk_border_layer(neighbours, 2, z) >> (CHUNK_SIZE * (CHUNK_SIZE - 1)));
+  case 3: return layer & ~((layer >> CHUNK_SIZE) | chunk_border_layer(neighbours, 3, z) << (CHUNK_SIZE * (CHUNK_SIZE - 1)));
+  case 4: return layer & ~(z != 0              ? layers[z-1] : 0);
+  case 5: return layer & ~(z != chunk.height-1 ? layers[z+1] : 0);
+  default: assert(false && "Unreachable");
+  }
+}
+
+// Shift a layer along x so that the bit of each block end up holding the bit
+// of its neighbour at x + dx, taken from the layer across the border on the
+// side the blocks come in from.
+static uint64_t layer_shift_x(uint64_t layer, uint64_t across, int dx)
+{
+  if(dx > 0) return ((layer >> 1) & ~LAYER_COLUMN_LAST)  | (across & LAYER_COLUMN_FIRST) << (CHUNK_SIZE - 1);
+  if(dx < 0) return ((layer << 1) & ~LAYER_COLUMN_FIRST) | (across & LAYER_COLUMN_LAST)  >> (CHUNK_SIZE - 1);
+  return layer;
+}
+
+// Mask of layer z where the bit of each block hold the bit of its neighbour
+// at (x + dx, y + dy), looking across the borders. Only the 4 horizontal
+// neighbours are known, so blocks in the chunks along the diagonals are air.
+static uint64_t chunk_layer_neighbours(const Chunk& chunk, const ChunkNeighbours& neighbours, int z, int dx, int dy)
+{
+  uint64_t layer = z >= 0 && (size_t)z < chunk.height ? chunk.occupancy[z] : 0;
+  layer = layer_shift_x(layer, chunk_border_layer(neighbours, dx > 0 ? 1 : 0, z), dx);
+  if(dy > 0) layer = layer >> CHUNK_SIZE | layer_shift_x(chunk_border_layer(neighbours, 3, z), 0, dx) << (CHUNK_SIZE * (CHUNK_SIZE - 1));
+  if(dy < 0) layer = layer << CHUNK_SIZE | layer_shift_x(chunk_border_layer(neighbours, 2, z), 0, dx) >> (CHUNK_SIZE * (CHUNK_SIZE - 1));
+  return layer;
+}
+
+// For the faces of a layer in one direction, masks of the blocks whose 8
+// neighbours around the block in front of the face are solid. These are
+// indexed by (du + 1) + (dv + 1) * 3 with du and dv the offsets along axis
+// (axis + 1) % 3 and (axis + 2) % 3, mask 4 being the block in front itself.
+struct ChunkFaceNeighbours
+{
+  uint64_t masks[9];
+};
+
+static ChunkFaceNeighbours chunk_face_neighbours(const Chunk& chunk, const ChunkNeighbours& chunk_neighbours, size_t z, size_t direction)
+{
+  const size_t axis = direction / 2;
+
+  ChunkFaceNeighbours neighbours;
+  for(int dv=-1; dv<=1; ++dv)
+    for(int du=-1; du<=1; ++du)
+    {
+      glm::ivec3 offset = {};
+      offset[axis]           = direction % 2 != 0 ? 1 : -1;
+      offset[(axis + 1) % 3] = du;
+      offset[(axis + 2) % 3] = dv;
+
+      neighbours.masks[(du + 1) + (dv + 1) * 3] = chunk_layer_neighbours(chunk, chunk_neighbours, (int)z + offset.z, offset.x, offset.y);
+    }
+  return neighbours;
+}
+
+// Occlusion of each corner of the face of block j from the two blocks along
+// its edges and the one diagonal to it, from 0 for none to 3. Corners take 2
+// bits each, at 2 * (u | v << 1) with u and v whether the corner is on the
+// positive side along each axis.
+static uint8_t chunk_face_ambient_occlusion(const ChunkFaceNeighbours& neighbours, size_t j)
+{
+  auto solid = [&](int du, int dv) -> uint32_t { return neighbours.masks[(du + 1) + (dv + 1) * 3] >> j & 1; };
+
+  uint8_t ambient_occlusion = 0;
+  for(int corner=0; corner<4; ++corner)
+  {
+    const int du = corner & 1 ? 1 : -1;
+    const int dv = corner & 2 ? 1 : -1;
+
+    const uint32_t side_u = solid(du, 0);
+    const uint32_t side_v = solid(0, dv);
+    const uint32_t occlusion = side_u && side_v ? 3 : side_u + side_v + solid(du, dv);
+    ambient_occlusion |= occlusion << (2 * corner);
+  }
+  return ambient_occlusion;
+}
+
+// Light of the block in front of the face of the block at position pointing
+// toward direction, looking across the border if needed. Blocks above a
+// chunk or in a missing neighbour are assumed to be open to the sky, and
+// blocks below a chunk to be dark.
+static uint8_t chunk_face_light(const Chunk& chunk, const ChunkNeighbours& neighbours, glm::ivec3 position, size_t direction)
+{
+  glm::ivec3 front = position;
+  front[direction / 2] += direction % 2 != 0 ? 1 : -1;
+
+  if(front.z < 0)
+    return 0;
+
+  if(front.x < 0 || front.x >= (int)CHUNK_SIZE || front.y < 0 || front.y >= (int)CHUNK_SIZE)
+  {
+    const ChunkBorder& border = neighbours.borders[direction];
+    if((size_t)front.z >= border.height)
+      return CHUNK_LIGHT_SKY_FULL;
+
+    return border.light[front.z * CHUNK_SIZE + (direction / 2 == 0 ? front.y : front.x)];
+  }
+
+  if(front.z >= (int)chunk.height)
+    return CHUNK_LIGHT_SKY_FULL;
+
+  return chunk_get_light(chunk, front.x, front.y, front.z);
+}
+
+// Emit a quad of width x height blocks lying on the face of the block at
+// position pointing toward direction. The quad spans along axis (axis + 1) % 3
+// for width and (axis + 2) % 3 for height, which makes their cross product
+// point toward the positive side of axis.
+static void chunk_mesh_emit_quad(vector<VoxelVertex>& vertices, vector<uint32_t>& indices, size_t direction, glm::ivec3 position, int width, int height, BlockType type, uint8_t ambient_occlusion, uint8_t light)
+{
+  const size_t axis     = direction / 2;
+  const size_t u_axis   = (axis + 1) % 3;
+  const size_t v_axis   = (axis + 2) % 3;
+  const bool   positive = direction % 2 != 0;
+
+  glm::ivec3 origin = position;
+  if(positive)
+    origin[axis] += 1;
+
+  glm::ivec3 du = {}; du[u_axis] = width;
+  glm::ivec3 dv = {}; dv[v_axis] = height;
+  if(!positive)
+    std::swap(du, dv); // Flip the winding order
+
+  const glm::ivec3 corners[4] = { glm::ivec3(0), du, du + dv, dv };
+
+  uint32_t occlusions[4];
+  const uint32_t base = size(vertices);
+  for(size_t i=0; i<4; ++i)
+  {
+    const size_t corner = (corners[i][u_axis] != 0) | (corners[i][v_axis] != 0) << 1;
+    occlusions[i] = ambient_occlusion >> (2 * corner) & 3;
+    vector_resize_push(vertices, voxel_vertex_pack(origin + corners[i], direction, occlusions[i], type, light));
+  }
+
+  // Split along the diagonal between the least occluded pair of corners.
+  // Otherwise the occlusion of a single corner would bleed along the
+  // diagonal, and the same configuration would look different depending on
+  // which corner it is in.
+  const uint32_t quad_indices[]         = { 0, 1, 2, 0, 2, 3 };
+  const uint32_t flipped_quad_indices[] = { 1, 2, 3, 1, 3, 0 };
+  const bool flip = occlusions[0] + occlusions[2] > occlusions[1] + occlusions[3];
+  for(size_t i=0; i<std::size(quad_indices); ++i)
+    vector_resize_push<uint32_t>(indices, base + (flip ? flipped_quad_indices[i] : quad_indices[i]));
+}
+
+static void chunk_mesh_culled(const Chunk& chunk, const ChunkNeighbours& chunk_neighbours, size_t z_begin, size_t z_end, vector<VoxelVertex>& vertices, vector<uint32_t>& indices)
+{
+  for(size_t z=z_begin; z<z_end; ++z)
+    for(size_t direction=0; direction<DIRECTION_COUNT; ++direction)
+    {
+      const uint64_t faces = chunk_exposed_faces(chunk, chunk_neighbours, z, direction);
+      if(faces == 0)
+        continue;
+
+      const ChunkFaceNeighbours neighbours = chunk_face_neighbours(chunk, chunk_neighbours, z, direction);
+      for(uint64_t remaining = faces; remaining != 0; remaining &= remaining - 1)
+      {
+        const size_t j = std::countr_zero(remaining);
+        const size_t x = j % CHUNK_SIZE;
+        const size_t y = j / CHUNK_SIZE;
+        const size_t i = z * CHUNK_SIZE * CHUNK_SIZE + j;
+        const glm::ivec3 position = glm::ivec3(x, y, z);
+        chunk_mesh_emit_quad(vertices, indices, direction, position, 1, 1, chunk.blocks[i], chunk_face_ambient_occlusion(neighbours, j), chunk_face_light(chunk, chunk_neighbours, position, direction));
+      }
+    }
+}
+
+// For every slice perpendicular to the face direction, collect the exposed
+// faces into a 2D grid of block indices and repeatedly grow the first
+// remaining face into the largest rectangle of faces with the same block
+// type and ambient occlusion, first along u and then along v. Quads never
+// cross the layers z_begin and z_end so that sections can be meshed
+// independently.
+static void chunk_mesh_greedy(const Chunk& chunk, const ChunkNeighbours& chunk_neighbours, size_t z_begin, size_t z_end, vector<VoxelVertex>& vertices, vector<uint32_t>& indices)
+{
+  static constexpr int32_t NO_FACE = -1;
+
+  const size_t origin[3]  = { 0, 0, z_begin };
+  const size_t extents[3] = { CHUNK_SIZE, CHUNK_SIZE, z_end - z_begin };
+  dynarray<int32_t> cells      = create_dynarray<int32_t>(CHUNK_SIZE * std::max(CHUNK_SIZE, extents[2]));
+  dynarray<uint8_t> occlusions = create_dynarray<uint8_t>(size(cells));
+
+  dynarray<uint8_t> lights     = create_dynarray<uint8_t>(size(cells));
+
+  // Faces can only be merged if they are equally lit and their corners are
+  // all equally occluded, or the lighting would be interpolated across the
+  // whole quad
+  auto same_face = [&](size_t cell, int32_t face, uint8_t occlusion, uint8_t light) {
+    return cells[cell] != NO_FACE && chunk.blocks[cells[cell]] == chunk.blocks[face] && occlusions[cell] == occlusion && lights[cell] == light;
+  };
+
+  dynarray<ChunkFaceNeighbours> neighbours = create_dynarray<ChunkFaceNeighbours>(extents[2]);
+
+  for(size_t direction=0; direction<DIRECTION_COUNT; ++direction)
+  {
+    const size_t axis   = direction / 2;
+    const size_t u_axis = (axis + 1) % 3;
+    const size_t v_axis = (axis + 2) % 3;
+    const size_t u_extent = extents[u_axis];
+    const size_t v_extent = extents[v_axis];
+
+    for(size_t z=0; z<extents[2]; ++z)
+      neighbours[z] = chunk_face_neighbours(chunk, chunk_neighbours, z_begin + z, direction);
+
+    for(size_t s=0; s<extents[axis]; ++s)
+    {
+      for(size_t v=0; v<v_extent; ++v)
+        for(size_t u=0; u<u_extent; ++u)
+        {
+          size_t position[3];
+          position[axis]   = origin[axis]   + s;
+          position[u_axis] = origin[u_axis] + u;
+          position[v_axis] = origin[v_axis] + v;
+
+          const size_t j = position[1] * CHUNK_SIZE + position[0];
+          const bool exposed = chunk_exposed_faces(chunk, chunk_neighbours, position[2], direction) & (uint64_t(1) << j);
+          cells[v * u_extent + u] = exposed ? position[2] * CHUNK_SIZE * CHUNK_SIZE + j : NO_FACE;
+          if(exposed)
+          {
+            occlusions[v * u_extent + u] = chunk_face_ambient_occlusion(neighbours[position[2] - z_begin], j);
+            lights[v * u_extent + u]     = chunk_face_light(chunk, chunk_neighbours, glm::ivec3(position[0], position[1], position[2]), direction);
+          }
+        }
+
+      for(size_t v=0; v<v_extent; ++v)
+        for(size_t u=0; u<u_extent; ++u)
+        {
+          const int32_t face = cells[v * u_extent + u];
+          if(face == NO_FACE)
+            continue;
+
+          const uint8_t occlusion = occlusions[v * u_extent + u];
+          const uint8_t light     = lights[v * u_extent + u];
+
+          size_t width = 1;
+          while(u + width < u_extent && same_face(v * u_extent + u + width, face, occlusion, light))
+            ++width;
+
+          size_t height = 1;
+          for(; v + height < v_extent; ++height)
+          {
+            size_t k = 0;
+            while(k < width && same_face((v + height) * u_extent + u + k, face, occlusion, light))
+              ++k;
+
+            if(k != width)
+              break;
+          }
+
+          for(size_t dv=0; dv<height; ++dv)
+            for(size_t du=0; du<width; ++du)
+              cells[(v + dv) * u_extent + u + du] = NO_FACE;
+
+          glm::ivec3 position;
+          position[axis]   = origin[axis]   + s;
+          position[u_axis] = origin[u_axis] + u;
+          position[v_axis] = origin[v_axis] + v;
+          chunk_mesh_emit_quad(vertices, indices, direction, position, width, height, chunk.blocks[face], occlusion, light);
+        }
+    }
+  }
+
+  destroy_dynarray(cells);
+  destroy_dynarray(occlusions);
+  destroy_dynarray(lights);
+  destroy_dynarray(neighbours);
+}
+
+// Flood fill the air of the section made of layers [z_begin, z_end), one
+// connected region at a time and growing every layer of the region at once,
+// then connect all the faces each region touches.
+static uint64_t chunk_section_visibility(const Chunk& chunk, size_t z_begin, size_t z_end)
+{
+  const size_t layer_count = z_end - z_begin;
+
+  uint64_t air[CHUNK_SECTION_HEIGHT];
+  uint64_t remaining[CHUNK_SECTION_HEIGHT]; // Air not part of any region yet
+  for(size_t z=0; z<layer_count; ++z)
+    air[z] = remaining[z] = ~chunk.occupancy[z_begin + z];
+
+  uint64_t visibility = 0;
+  for(size_t z=0; z<layer_count; ++z)
+    while(remaining[z] != 0)
+    {
+      uint64_t region[CHUNK_SECTION_HEIGHT] = {};
+      region[z] = remaining[z] & -remaining[z];
+
+      for(bool grown = true; grown;)
+      {
+        grown = false;
+        for(size_t l=0; l<layer_count; ++l)
+        {
+          const uint64_t layer = region[l];
+
+          uint64_t next = layer | ((layer << 1) & ~LAYER_COLUMN_FIRST) | ((layer >> 1) & ~LAYER_COLUMN_LAST) | layer << CHUNK_SIZE | layer >> CHUNK_SIZE;
+          if(l != 0)               next |= region[l - 1];
+          if(l + 1 != layer_count) next |= region[l + 1];
+          next &= air[l];
+
+          grown |= next != layer;
+          region[l] = next;
+        }
+      }
+
+      uint32_t faces = 0;
+      for(size_t l=0; l<layer_count; ++l)
+      {
+        remaining[l] &= ~region[l];
+        if(region[l] & LAYER_COLUMN_FIRST) faces |= 1u << 0;
+        if(region[l] & LAYER_COLUMN_LAST)  faces |= 1u << 1;
+        if(region[l] & LAYER_ROW_FIRST)    faces |= 1u << 2;
+        if(region[l] & LAYER_ROW_LAST)     faces |= 1u << 3;
+      }
+      if(region[0])               faces |= 1u << 4;
+      if(region[layer_count - 1]) faces |= 1u << 5;
+
+      for(uint32_t remaining_faces = faces; remaining_faces != 0; remaining_faces &= remaining_faces - 1)
+        visibility |= (uint64_t)faces << (std::countr_zero(remaining_faces) * 6);
+    }
+
+  return visibility;
+}
+
+// Every section is given room for this many more quads than it had when the
+// chunk was first meshed, on top of a fraction of its initial quad count.
+static constexpr uint32_t CHUNK_MESH_SECTION_SLACK_QUADS = 8;
+
+static uint32_t chunk_mesh_section_capacity(uint32_t quad_count)
+{
+  return quad_count + quad_count / 4 + CHUNK_MESH_SECTION_SLACK_QUADS;
+}
+
+// Indices are split six ways, and an edit rarely adds more than one or two
+// faces in each direction, so each direction is given less room on its own.
+static constexpr uint32_t CHUNK_MESH_DIRECTION_SLACK_QUADS = 2;
+
+static uint32_t chunk_mesh_direction_capacity(uint32_t quad_count)
+{
+  return quad_count + quad_count / 4 + CHUNK_MESH_DIRECTION_SLACK_QUADS;
+}
+
+// Position of the face of a quad along its axis, counted from the side its
+// direction points to so that smaller is closer to anything that can see it
+static uint32_t chunk_mesh_quad_depth(const VoxelVertex& vertex, size_t direction)
+{
+  static constexpr uint32_t AXIS_SHIFTS[3] = { 0, 8, 16 };
+  static constexpr uint32_t AXIS_MASKS[3]  = { 0xff, 0xff, 0xffff };
+
+  const size_t   axis     = direction / 2;
+  const uint32_t position = vertex.position >> AXIS_SHIFTS[axis] & AXIS_MASKS[axis];
+  return direction % 2 != 0 ? AXIS_MASKS[axis] - position : position;
+}
+
+// Reorder the quads of a section, whose indices start at first_index, by
+// direction and split its indices into one range per direction. Within a
+// direction, every quad faces the same way and so quads are drawn front to
+// back from wherever they can be seen, which is the best order for overdraw.
+// The vertices of the section are then renumbered in the order they are
+// drawn so that they are fetched sequentially.
+static void chunk_mesh_section_sort(vector<VoxelVertex>& vertices, vector<uint32_t>& indices, ChunkMeshSection& mesh_section)
+{
+  struct Quad
+  {
+    uint32_t indices[6];
+  };
+
+  const size_t first_index = mesh_section.first_index[0];
+  const size_t index_count = size(indices) - first_index;
+  uint32_t *section_indices = &data(indices)[first_index];
+
+  const auto quad_direction = [&](const uint32_t *quad) { return vertices.data[quad[0]].attributes & 0x7; };
+  const auto quad_key       = [&](const Quad& quad) {
+    const size_t direction = quad_direction(quad.indices);
+    return uint64_t(direction) << 32 | chunk_mesh_quad_depth(vertices.data[quad.indices[0]], direction);
+  };
+
+  uint32_t counts[6] = {};
+  for(size_t i=0; i<index_count; i+=6)
+    counts[quad_direction(&section_indices[i])] += 6;
+
+  for(size_t direction=0, offset=0; direction<6; offset += counts[direction++])
+  {
+    mesh_section.first_index[direction] = first_index + offset;
+    mesh_section.index_count[direction] = counts[direction];
+  }
+
+  Quad *quads = reinterpret_cast<Quad *>(section_indices);
+  std::stable_sort(quads, quads + index_count / 6, [&](const Quad& a, const Quad& b) { return quad_key(a) < quad_key(b); });
+
+  const size_t vertex_count = size(vertices) - mesh_section.first_vertex;
+  for(size_t i=0; i<index_count; ++i)
+    section_indices[i] -= mesh_section.first_vertex;
+
+  vulkan::mesh_optimize_vertex_fetch(&data(vertices)[mesh_section.first_vertex], sizeof(VoxelVertex), vertex_count, section_indices, index_count);
+
+  for(size_t i=0; i<index_count; ++i)
+    section_indices[i] += mesh_section.first_vertex;
+}
+
+// Mesh the sections whose bit is set in section_mask. The others are left
+// with empty ranges.
+static ChunkMeshData chunk_generate_sections_mesh_data(const Chunk& chunk, const ChunkNeighbours& neighbours, ChunkMeshMode mode, uint64_t section_mask)
+{
+  ChunkMeshData mesh_data = {};
+  mesh_data.vertices = create_vector<VoxelVertex>(1);
+  mesh_data.indices  = create_vector<uint32_t>(1);
+  mesh_data.sections = create_dynarray<ChunkMeshSection>(chunk_section_count(chunk));
+
+  for(size_t section=0; section<size(mesh_data.sections); ++section)
+  {
+    ChunkMeshSection& mesh_section = mesh_data.sections[section];
+    mesh_section = {};
+    mesh_section.first_vertex = size(mesh_data.vertices);
+    std::fill_n(mesh_section.first_index, 6, size(mesh_data.indices));
+
+    if(section_mask & (uint64_t(1) << section))
+    {
+      const size_t z_begin = section * CHUNK_SECTION_HEIGHT;
+      const size_t z_end   = std::min(z_begin + CHUNK_SECTION_HEIGHT, chunk.height);
+      switch(mode)
+      {
+      case ChunkMeshMode::CULLED: chunk_mesh_culled(chunk, neighbours, z_begin, z_end, mesh_data.vertices, mesh_data.indices); break;
+      case ChunkMeshMode::GREEDY: chunk_mesh_greedy(chunk, neighbours, z_begin, z_end, mesh_data.vertices, mesh_data.indices); break;
+      }
+      chunk_mesh_section_sort(mesh_data.vertices, mesh_data.indices, mesh_section);
+      mesh_section.visibility = chunk_section_visibility(chunk, z_begin, z_end);
+    }
+
+    mesh_section.vertex_count = size(mesh_data.vertices) - mesh_section.first_vertex;
+  }
+
+  return mesh_data;
+}
+
+ChunkMeshData chunk_generate_mesh_data(const Chunk& chunk, const ChunkNeighbours& neighbours, ChunkMeshMode mode)
+{
+  return chunk_generate_sections_mesh_data(chunk, neighbours, mode, ~uint64_t(0));
+}
+
+void chunk_mesh_data_destroy(ChunkMeshData& mesh_data)
+{
+  destroy_vector(mesh_data.vertices);
+  destroy_vector(mesh_data.indices);
+  destroy_dynarray(mesh_data.sections);
+}
+
+// Copy a section of mesh_data into its ranges, rebasing its indices and
+// padding the rest of each index range with degenerate triangles. indices
+// point to where the range of each direction goes.
+static void chunk_mesh_section_pack(const ChunkMeshData& mesh_data, size_t section, const ChunkMeshSection& range, VoxelVertex *vertices, uint32_t *const indices[6])
+{
+  const ChunkMeshSection& mesh_section = mesh_data.sections[section];
+  assert(mesh_section.vertex_count <= range.vertex_count);
+
+  const VoxelVertex *section_vertices = &data(mesh_data.vertices)[mesh_section.first_vertex];
+  std::copy(section_vertices, section_vertices + mesh_section.vertex_count, vertices);
+  std::fill(vertices + mesh_section.vertex_count, vertices + range.vertex_count, VoxelVertex{});
+
+  for(size_t direction=0; direction<6; ++direction)
+  {
+    assert(mesh_section.index_count[direction] <= range.index_count[direction]);
+
+    const uint32_t *section_indices = &data(mesh_data.indices)[mesh_section.first_index[direction]];
+    for(size_t i=0; i<mesh_section.index_count[direction]; ++i)
+      indices[direction][i] = section_indices[i] - mesh_section.first_vertex + range.first_vertex;
+    std::fill(indices[direction] + mesh_section.index_count[direction], indices[direction] + range.index_count[direction], range.first_vertex);
+  }
+}
+
+ChunkMesh chunk_mesh_data_upload(vulkan::command_buffer_t command_buffer, vulkan::context_t context, vulkan::allocator_t allocator, const ChunkMeshData& mesh_data)
+{
+  ChunkMesh chunk_mesh = {};
+  if(size(mesh_data.sections) == 0)
+    return chunk_mesh;
+
+  size_t vertex_count = 0;
+  chunk_mesh.sections = create_dynarray<ChunkMeshSection>(size(mesh_data.sections));
+  for(size_t section=0; section<size(mesh_data.sections); ++section)
+  {
+    const uint32_t quad_count = mesh_data.sections[section].vertex_count / 4;
+
+    ChunkMeshSection& range = chunk_mesh.sections[section];
+    range.first_vertex = vertex_count;
+    range.vertex_count = chunk_mesh_section_capacity(quad_count) * 4;
+    range.visibility   = mesh_data.sections[section].visibility;
+
+    vertex_count += range.vertex_count;
+  }
+
+  // Every section takes room for its own edits in each direction
+  size_t index_count = 0;
+  for(size_t direction=0; direction<6; ++direction)
+    for(size_t section=0; section<size(mesh_data.sections); ++section)
+    {
+      const uint32_t quad_count = mesh_data.sections[section].index_count[direction] / 6;
+
+      ChunkMeshSection& range = chunk_mesh.sections[section];
+      range.first_index[direction] = index_count;
+      range.index_count[direction] = chunk_mesh_direction_capacity(quad_count) * 6;
+
+      index_count += range.index_count[direction];
+    }
+
+  dynarray<VoxelVertex> vertices = create_dynarray<VoxelVertex>(vertex_count);
+  dynarray<uint32_t>    indices  = create_dynarray<uint32_t>(index_count);
+  for(size_t section=0; section<size(mesh_data.sections); ++section)
+  {
+    const ChunkMeshSection& range = chunk_mesh.sections[section];
+
+    uint32_t *range_indices[6];
+    for(size_t direction=0; direction<6; ++direction)
+      range_indices[direction] = &data(indices)[range.first_index[direction]];
+
+    chunk_mesh_section_pack(mesh_data, section, range, &data(vertices)[range.first_vertex], range_indices);
+  }
+
+  vulkan::mesh_layout_t mesh_layout = voxel_mesh_layout_create();
+  chunk_mesh.mesh = vulkan::mesh_create(context, allocator, mesh_layout, vertex_count, index_count);
+  vulkan::put(mesh_layout);
+
+  const void     *_vertices[] = { data(vertices) };
+  const uint32_t *_indices    = data(indices);
+  vulkan::mesh_write(command_buffer, chunk_mesh.mesh, _vertices, _indices);
+
+  destroy_dynarray(vertices);
+  destroy_dynarray(indices);
+  return chunk_mesh;
+}
+
+void chunk_mesh_destroy(ChunkMesh& chunk_mesh)
+{
+  if(chunk_mesh.mesh)
+    vulkan::put(chunk_mesh.mesh);
+
+  destroy_dynarray(chunk_mesh.sections);
+  chunk_mesh.mesh = nullptr;
+}
+
+ChunkMesh chunk_mesh_share(const ChunkMesh& chunk_mesh)
+{
+  ChunkMesh shared = {};
+  if(!chunk_mesh.mesh)
+    return shared;
+
+  vulkan::get(chunk_mesh.mesh);
+  shared.mesh     = chunk_mesh.mesh;
+  shared.sections = create_dynarray<ChunkMeshSection>(size(chunk_mesh.sections));
+  std::copy_n(data(chunk_mesh.sections), size(chunk_mesh.sections), data(shared.sections));
+  return shared;
+}
+
+bool chunk_mesh_is_shared(const ChunkMesh& chunk_mesh)
+{
+  return chunk_mesh.mesh && vulkan::as_ref(chunk_mesh.mesh)->count > 1;
+}
+
+size_t chunk_mesh_memory_usage(const ChunkMesh& chunk_mesh)
+{
+  if(size(chunk_mesh.sections) == 0)
+    return 0;
+
+  // The ranges of the last section come last in the vertex buffer and in the
+  // last direction of the index buffer
+  const ChunkMeshSection& last = chunk_mesh.sections[size(chunk_mesh.sections) - 1];
+  return (last.first_vertex + last.vertex_count) * sizeof(VoxelVertex) + (last.first_index[5] + last.index_count[5]) * sizeof(uint32_t);
+}
+
+bool chunk_mesh_update(vulkan::command_buffer_t command_buffer, ChunkMesh& chunk_mesh, Chunk& chunk, const ChunkNeighbours& neighbours, ChunkMeshMode mode)
+{
+  assert(!chunk_mesh_is_shared(chunk_mesh));
+  assert(size(chunk_mesh.sections) == chunk_section_count(chunk));
+  if(chunk.dirty_sections == 0)
+    return true;
+
+  // Mesh every dirty section before writing anything, so that we can still
+  // back out if one of them does not fit.
+  ChunkMeshData mesh_data = chunk_generate_sections_mesh_data(chunk, neighbours, mode, chunk.dirty_sections);
+  for(size_t section=0; section<size(mesh_data.sections); ++section)
+  {
+    bool fits = mesh_data.sections[section].vertex_count <= chunk_mesh.sections[section].vertex_count;
+    for(size_t direction=0; direction<6; ++direction)
+      fits &= mesh_data.sections[section].index_count[direction] <= chunk_mesh.sections[section].index_count[direction];
+
+    if(!fits)
+    {
+      chunk_mesh_data_destroy(mesh_data);
+      return false;
+    }
+  }
+
+  for(uint64_t sections = chunk.dirty_sections; sections != 0; sections &= sections - 1)
+  {
+    const size_t section = std::countr_zero(sections);
+    const ChunkMeshSection& range = chunk_mesh.sections[section];
+
+    size_t index_count = 0;
+    for(size_t direction=0; direction<6; ++direction)
+      index_count += range.index_count[direction];
+
+    dynarray<VoxelVertex> vertices = create_dynarray<VoxelVertex>(range.vertex_count);
+    dynarray<uint32_t>    indices  = create_dynarray<uint32_t>(index_count);
+
+    uint32_t *range_indices[6];
+    for(size_t direction=0, offset=0; direction<6; offset += range.index_count[direction++])
+      range_indices[direction] = &data(indices)[offset];
+
+    chunk_mesh_section_pack(mesh_data, section, range, data(vertices), range_indices);
+
+    // Vertices past the end of the section are not referenced by any index.
+    // Everything goes out in one write so that the section costs a single
+    // staging buffer and copy rather than one per range.
+    vulkan::MeshIndexWrite index_writes[6];
+    for(size_t direction=0; direction<6; ++direction)
+      index_writes[direction] = { range_indices[direction], range.first_index[direction], range.index_count[direction] };
+
+    const void *_vertices[] = { data(vertices) };
+    vulkan::mesh_write(command_buffer, chunk_mesh.mesh,
+        _vertices, range.first_vertex, mesh_data.sections[section].vertex_count,
+        index_writes, 6);
+
+    destroy_dynarray(vertices);
+    destroy_dynarray(indices);
+
+    chunk_mesh.sections[section].visibility = mesh_data.sections[section].visibility;
+  }
+
+  chunk_mesh_data_destroy(mesh_data);
+  chunk.dirty_sections = 0;
+  return true;
+}
+
+ChunkMesh chunk_generate_mesh(vulkan::command_buffer_t command_buffer, vulkan::context_t context, vulkan::allocator_t allocator, const Chunk& chunk, ChunkMeshMode mode)
+{
+  ChunkMeshData mesh_data = chunk_generate_mesh_data(chunk, ChunkNeighbours{}, mode);
+
+  printf("vertices size = %ld\n", size(mesh_data.vertices));
+  printf("indices  size = %ld\n", size(mesh_data.indices));
+
+  ChunkMesh chunk_mesh = chunk_mesh_data_upload(command_buffer, context, allocator, mesh_data);
+  chunk_mesh_data_destroy(mesh_data);
+  return chunk_mesh;
+}
@@ -6,98 +6,269 @@
 #include <glm/glm.hpp>
 
 #include <stddef.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <time.h>
+#include <stdint.h>
 
-struct Block
+// Index into the block palette. The palette is global so that a block only
+// need to store a single byte, and the color of a block is looked up only
+// when it is drawn, from the palette in shaders/voxel.vert.
+enum class BlockType : uint8_t
 {
-  bool valid;
-  glm::vec3 color;
+  AIR,
+  STONE,
+  DIRT,
+  GRASS,
+  SAND,
+  SNOW,
+  LAMP, // Emit block light, see chunk_light.hpp
+  COUNT,
 };
 
 static constexpr size_t CHUNK_SIZE = 8;
 static constexpr float  BLOCK_WIDTH = 0.2f;
 
+// A whole layer of a chunk fits in a single 64-bit occupancy mask, with bit
+// (y * CHUNK_SIZE + x) set if block (x, y, z) is not air. The mesher works
+// almost entirely on the occupancy masks and only touch the block types for
+// the faces it actually emit.
+static_assert(CHUNK_SIZE * CHUNK_SIZE == 64);
+
+// Chunks are meshed in sections of CHUNK_SECTION_HEIGHT layers, so that
+// editing a block only rebuild the sections around it. One bit per section
+// must fit in Chunk::dirty_sections, which limit the height of a chunk.
+static constexpr size_t CHUNK_SECTION_HEIGHT = 8;
+static constexpr size_t CHUNK_MAX_HEIGHT     = 64 * CHUNK_SECTION_HEIGHT;
+
 struct Chunk
 {
   size_t height;
-  Block *blocks;
+
+  uint64_t  *occupancy; // One mask per layer
+  BlockType *blocks;    // Indexed by z * CHUNK_SIZE * CHUNK_SIZE + y * CHUNK_SIZE + x
+  uint8_t   *light;     // Indexed as blocks, skylight in the high nibble and block light in the low one
+
+  uint64_t dirty_sections; // Bit s set if section s changed since it was last meshed
 };
 
-inline Chunk chunk_generate_random()
+// Masks of the blocks of a layer on each side along x, bit y * CHUNK_SIZE + x
+// of an occupancy mask being block (x, y)
+static constexpr uint64_t LAYER_COLUMN_FIRST = 0x0101010101010101; // Bits with x == 0
+static constexpr uint64_t LAYER_COLUMN_LAST  = LAYER_COLUMN_FIRST << (CHUNK_SIZE - 1); // Bits with x == CHUNK_SIZE - 1
+
+Chunk chunk_create(size_t height);
+Chunk chunk_generate_random(unsigned seed);
+void chunk_destroy(const Chunk& chunk);
+
+inline size_t chunk_block_index(size_t x, size_t y, size_t z)
+{
+  return z * CHUNK_SIZE * CHUNK_SIZE + y * CHUNK_SIZE + x;
+}
+
+inline bool chunk_is_solid(const Chunk& chunk, size_t x, size_t y, size_t z)
 {
-  srand(time(NULL));
+  return chunk.occupancy[z] & (uint64_t(1) << (y * CHUNK_SIZE + x));
+}
 
-  Chunk chunk = {};
-  chunk.height = (size_t)rand() % 256;
-  chunk.blocks = new Block[CHUNK_SIZE * CHUNK_SIZE * chunk.height];
-  for(size_t i=0; i<CHUNK_SIZE * CHUNK_SIZE * chunk.height; ++i)
-  {
-    chunk.blocks[i].valid = (unsigned)rand() % 8 == 0;
-    chunk.blocks[i].color = glm::vec3(1.0f, 1.0f, (float)i / (float)(CHUNK_SIZE * CHUNK_SIZE * chunk.height));
-  }
+inline BlockType chunk_get_block(const Chunk& chunk, size_t x, size_t y, size_t z)
+{
+  return chunk.blocks[chunk_block_index(x, y, z)];
+}
 
-  return chunk;
+inline size_t chunk_section_count(const Chunk& chunk)
+{
+  return (chunk.height + CHUNK_SECTION_HEIGHT - 1) / CHUNK_SECTION_HEIGHT;
 }
 
-inline void chunk_destroy(const Chunk& chunk)
+// Both kinds of light go from 0 in complete darkness to CHUNK_LIGHT_MAX
+static constexpr uint8_t CHUNK_LIGHT_MAX      = 15;
+static constexpr uint8_t CHUNK_LIGHT_SKY_FULL = CHUNK_LIGHT_MAX << 4;
+
+inline uint8_t chunk_get_light(const Chunk& chunk, size_t x, size_t y, size_t z)
 {
-  delete[] chunk.blocks;
+  return chunk.light[chunk_block_index(x, y, z)];
 }
 
-inline vulkan::mesh_t chunk_generate_mesh(vulkan::command_buffer_t command_buffer, vulkan::context_t context, vulkan::allocator_t allocator, const Chunk& chunk)
-{
-  vector<vulkan::Vertex> vertices = create_vector<vulkan::Vertex>(1);
-  vector<uint32_t>       indices  = create_vector<uint32_t>(1);
-
-  for(size_t z=0; z<chunk.height; ++z)
-    for(size_t y=0; y<CHUNK_SIZE; ++y)
-      for(size_t x=0; x<CHUNK_SIZE; ++x)
-      {
-        size_t i = z * CHUNK_SIZE * CHUNK_SIZE + y * CHUNK_SIZE + x;
-        if(!chunk.blocks[i].valid)
-          continue;
-
-        vulkan::Vertex block_vertices[] = {
-          {.pos = glm::vec3(x,   y,   z  ) * BLOCK_WIDTH, .normal = {}, .color = chunk.blocks[i].color, .uv = {}},
-          {.pos = glm::vec3(x,   y,   z+1) * BLOCK_WIDTH, .normal = {}, .color = chunk.blocks[i].color, .uv = {}},
-          {.pos = glm::vec3(x,   y+1, z  ) * BLOCK_WIDTH, .normal = {}, .color = chunk.blocks[i].color, .uv = {}},
-          {.pos = glm::vec3(x,   y+1, z+1) * BLOCK_WIDTH, .normal = {}, .color = chunk.blocks[i].color, .uv = {}},
-          {.pos = glm::vec3(x+1, y,   z  ) * BLOCK_WIDTH, .normal = {}, .color = chunk.blocks[i].color, .uv = {}},
-          {.pos = glm::vec3(x+1, y,   z+1) * BLOCK_WIDTH, .normal = {}, .color = chunk.blocks[i].color, .uv = {}},
-          {.pos = glm::vec3(x+1, y+1, z  ) * BLOCK_WIDTH, .normal = {}, .color = chunk.blocks[i].color, .uv = {}},
-          {.pos = glm::vec3(x+1, y+1, z+1) * BLOCK_WIDTH, .normal = {}, .color = chunk.blocks[i].color, .uv = {}},
-        };
-        uint32_t block_indices[] = {
-          3, 2, 0, 1, 3, 0,
-          5, 4, 6, 7, 5, 6,
-          7, 6, 2, 3, 7, 2,
-          1, 0, 4, 5, 1, 4,
-          6, 4, 0, 2, 6, 0,
-          1, 5, 7, 1, 7, 3,
-        };
-
-        for(size_t i=0; i<std::size(block_indices); ++i)
-          vector_resize_push<uint32_t>(indices, size(vertices) + block_indices[i]);
-
-        for(size_t i=0; i<std::size(block_vertices); ++i)
-          vector_resize_push(vertices, block_vertices[i]);
-      }
-
-  printf("vertices size = %ld\n", size(vertices));
-  printf("indices  size = %ld\n", size(indices));
-
-  vulkan::mesh_layout_t mesh_layout = vulkan::mesh_layout_create_default();
-  vulkan::mesh_t        mesh        = vulkan::mesh_create(context, allocator, mesh_layout, size(vertices), size(indices));
-  vulkan::put(mesh_layout);
-
-  const void     *_vertices[] = { data(vertices) };
-  const uint32_t *_indices    = data(indices);
-  vulkan::mesh_write(command_buffer, mesh, _vertices, _indices);
-
-  destroy_vector(vertices);
-  destroy_vector(indices);
-  return mesh;
+// Mark the sections whose mesh may change when something in layer z does as
+// dirty. This include the neighbouring sections if z is on their boundary
+// since the faces of the blocks right above and below may be affected.
+inline void chunk_mark_dirty(Chunk& chunk, size_t z)
+{
+  const size_t section = z / CHUNK_SECTION_HEIGHT;
+  chunk.dirty_sections |= uint64_t(1) << section;
+  if(z % CHUNK_SECTION_HEIGHT == 0 && z != 0)
+    chunk.dirty_sections |= uint64_t(1) << (section - 1);
+  if(z % CHUNK_SECTION_HEIGHT == CHUNK_SECTION_HEIGHT - 1 && z + 1 != chunk.height)
+    chunk.dirty_sections |= uint64_t(1) << (section + 1);
 }
 
+// Also mark every section whose mesh may change as a result as dirty. The
+// light is left as is, see chunk_light_update.
+void chunk_set_block(Chunk& chunk, size_t x, size_t y, size_t z, BlockType type);
+
+// Memory used by the block and light storage of the chunk in bytes
+size_t chunk_memory_usage(const Chunk& chunk);
+
+// 64-bit hash of the height, blocks and light of the chunk. The occupancy
+// masks are derived from the blocks so they are not hashed.
+uint64_t chunk_hash(const Chunk& chunk);
+
+// Distant chunks are meshed at a lower level of detail, where level l merge
+// cubes of 2^l blocks on a side. A cube never straddle a section.
+static constexpr size_t CHUNK_LOD_COUNT = 4;
+static_assert(CHUNK_SECTION_HEIGHT % (size_t(1) << (CHUNK_LOD_COUNT - 1)) == 0);
+
+// Copy of chunk where every cube of the given level of detail is either all
+// air, or if at least half of it is solid, all made of the most common block
+// type in its highest non-empty layer so that grass stays on top. The result
+// has the same dimensions as chunk so it is meshed exactly the same way, and
+// greedy meshing then merge the faces of each cube back together. Its light
+// is left unlit, see chunk_light_init.
+Chunk chunk_downsample(const Chunk& chunk, size_t level);
+
+// Copy of the blocks of a neighbouring chunk along the border it shares with
+// a chunk, which is all the mesher needs to know about that neighbour to
+// cull the faces between them and to occlude and light the faces along the
+// border. Being a copy, it stays valid while the neighbour is edited or
+// unloaded during meshing.
+struct ChunkBorder
+{
+  size_t    height;
+  uint64_t *occupancy; // Layers of the neighbour, keeping only the blocks along the border
+  uint8_t  *light;     // CHUNK_SIZE per layer, of the blocks along the border ordered by x or y
+};
+
+// direction is the one going from the chunk being meshed to neighbour,
+// ordered like the faces.
+ChunkBorder chunk_border_create(const Chunk& neighbour, size_t direction);
+void chunk_border_destroy(ChunkBorder& border);
+
+// Borders of the 4 horizontal neighbours of a chunk, ordered -X, +X, -Y, +Y
+// like the faces. Missing neighbours are left zeroed, and treated as if they
+// were only air lit by the sky.
+struct ChunkNeighbours
+{
+  ChunkBorder borders[4];
+};
+
+void chunk_neighbours_destroy(ChunkNeighbours& neighbours);
+
+// Bit d set if the border in direction d is known
+uint32_t chunk_neighbours_sides(const ChunkNeighbours& neighbours);
+
+uint64_t chunk_neighbours_hash(const ChunkNeighbours& neighbours);
+
+enum class ChunkMeshMode
+{
+  CULLED, // One quad per exposed face
+  GREEDY, // Merge coplanar adjacent exposed faces of the same block type into larger quads
+};
+
+// Vertex of a chunk mesh packed into 8 bytes, down from the 44 bytes of
+// vulkan::Vertex, and unpacked by shaders/voxel.vert:
+//
+//   position   bits 0-7 x, 8-15 y, 16-31 z, in blocks relative to the chunk
+//   attributes bits 0-2 face direction, 3-4 ambient occlusion, 5-12 block type,
+//              13-16 block light, 17-20 skylight
+//
+// Ambient occlusion goes from 0 for a fully lit corner to 3 for a corner
+// between two solid blocks, and is computed by the mesher from the blocks
+// around the corner. The light is that of the block in front of the face.
+struct VoxelVertex
+{
+  uint32_t position;
+  uint32_t attributes;
+};
+static_assert(sizeof(VoxelVertex) == 8);
+
+inline VoxelVertex voxel_vertex_pack(glm::ivec3 position, size_t direction, uint32_t ambient_occlusion, BlockType type, uint8_t light)
+{
+  assert(position.x >= 0 && position.x <= (int)CHUNK_SIZE);
+  assert(position.y >= 0 && position.y <= (int)CHUNK_SIZE);
+  assert(position.z >= 0 && position.z <= (int)CHUNK_MAX_HEIGHT);
+  assert(direction < 6 && ambient_occlusion < 4);
+
+  VoxelVertex vertex;
+  vertex.position   = (uint32_t)position.x | (uint32_t)position.y << 8 | (uint32_t)position.z << 16;
+  vertex.attributes = (uint32_t)direction | ambient_occlusion << 3 | (uint32_t)type << 5 | (uint32_t)light << 13;
+  return vertex;
+}
+
+vulkan::mesh_layout_t voxel_mesh_layout_create();
+
+// Vertices and indices belonging to one section of a chunk mesh, with one
+// range of indices per face direction so that faces pointing away from the
+// camera can be skipped, along with which of its faces can see each other
+// through the air inside of it, with bit a * 6 + b set if something looking
+// in through face a can see out through face b. Faces are ordered like mesh
+// faces.
+struct ChunkMeshSection
+{
+  uint32_t first_vertex;
+  uint32_t vertex_count;
+  uint32_t first_index[6];
+  uint32_t index_count[6];
+
+  uint64_t visibility;
+};
+
+inline bool chunk_section_visible(uint64_t visibility, size_t from, size_t to)
+{
+  return visibility >> (from * 6 + to) & 1;
+}
+
+// CPU side of a chunk mesh, ready to be uploaded with chunk_mesh_data_upload.
+// The index ranges of each section directly follow each other.
+struct ChunkMeshData
+{
+  vector<VoxelVertex> vertices;
+  vector<uint32_t>    indices;
+
+  dynarray<ChunkMeshSection> sections;
+};
+
+// GPU side of a chunk mesh. Every section own a fixed range of the vertex and
+// index buffers with some room to grow, so that it can be rebuilt and written
+// in place after an edit. The unused part of the index ranges of a section is
+// filled with degenerate triangles.
+//
+// The index buffer is split into six parts, one per face direction, each
+// holding the ranges of every section in order, so that the faces of
+// consecutive sections pointing the same way can be drawn together.
+struct ChunkMesh
+{
+  vulkan::mesh_t mesh; // nullptr for a chunk without any section
+
+  // The counts here are the capacities of the ranges
+  dynarray<ChunkMeshSection> sections;
+};
+
+// Only faces that are not covered by a neighbouring block are emitted,
+// looking across the borders given in neighbours. Faces on the sides without
+// a neighbour always are, which is also what hide the cracks between
+// neighbouring chunks meshed at different levels of detail. Greedy meshing
+// costs more CPU time but produces far smaller meshes, which is what we want
+// for terrain that does not change.
+//
+// chunk_generate_mesh_data only read from the chunk and touch no Vulkan
+// object, so it can be called from any thread.
+ChunkMeshData chunk_generate_mesh_data(const Chunk& chunk, const ChunkNeighbours& neighbours, ChunkMeshMode mode);
+void chunk_mesh_data_destroy(ChunkMeshData& mesh_data);
+
+ChunkMesh chunk_mesh_data_upload(vulkan::command_buffer_t command_buffer, vulkan::context_t context, vulkan::allocator_t allocator, const ChunkMeshData& mesh_data);
+void chunk_mesh_destroy(ChunkMesh& chunk_mesh);
+
+// Take a new reference to the same GPU mesh, which must then not be updated
+// in place for as long as chunk_mesh_is_shared return true.
+ChunkMesh chunk_mesh_share(const ChunkMesh& chunk_mesh);
+bool chunk_mesh_is_shared(const ChunkMesh& chunk_mesh);
+
+// GPU memory used by the vertex and index buffers of the mesh in bytes
+size_t chunk_mesh_memory_usage(const ChunkMesh& chunk_mesh);
+
+// Rebuild the dirty sections of chunk and write them in place into
+// chunk_mesh, which may still be in use by previously submitted commands,
+// then clear chunk.dirty_sections. If a section has outgrown its range,
+// return false without touching either, in which case the whole chunk has to
+// be meshed and uploaded again.
+bool chunk_mesh_update(vulkan::command_buffer_t command_buffer, ChunkMesh& chunk_mesh, Chunk& chunk, const ChunkNeighbours& neighbours, ChunkMeshMode mode);
+
+ChunkMesh chunk_generate_mesh(vulkan::command_buffer_t command_buffer, vulkan::context_t context, vulkan::allocator_t allocator, const Chunk& chunk, ChunkMeshMode mode = ChunkMeshMode::CULLED);
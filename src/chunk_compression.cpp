@@ -0,0 +1,278 @@
+#include "chunk_compression.hpp"
+
+#include <bit>
+
+#include <assert.h>
+#include <string.h>
+
+static unsigned compressed_chunk_index_bits(size_t palette_size)
+{
+  if(palette_size <= 1)
+    return 0;
+
+  return std::bit_width(unsigned(palette_size - 1));
+}
+
+static void chunk_compress_varint(vector<uint8_t>& runs, size_t value)
+{
+  do
+  {
+    const uint8_t byte = value & 0x7F;
+    value >>= 7;
+    vector_resize_push<uint8_t>(runs, value != 0 ? byte | 0x80 : byte);
+  } while(value != 0);
+}
+
+static void chunk_compress_run(vector<uint8_t>& runs, unsigned index_bits, uint8_t index, size_t length)
+{
+  const size_t length_escape = (size_t(1) << (8 - index_bits)) - 1;
+  const size_t length_header = std::min(length - 1, length_escape);
+  vector_resize_push<uint8_t>(runs, index | (length_header << index_bits));
+
+  if(length_header != length_escape)
+    return;
+
+  chunk_compress_varint(runs, length - 1 - length_escape);
+}
+
+// Shrink to fit since compressed chunks are meant to stay around for a while
+static dynarray<uint8_t> chunk_compress_finish(vector<uint8_t>& runs)
+{
+  dynarray<uint8_t> result = create_dynarray<uint8_t>(size(runs));
+  std::copy_n(data(runs), size(runs), data(result));
+  destroy_vector(runs);
+  return result;
+}
+
+static dynarray<uint8_t> chunk_compress_light(const Chunk& chunk)
+{
+  const size_t block_count = CHUNK_SIZE * CHUNK_SIZE * chunk.height;
+
+  vector<uint8_t> runs = create_vector<uint8_t>(64);
+  for(size_t i=0; i<block_count;)
+  {
+    size_t j = i + 1;
+    while(j < block_count && chunk.light[j] == chunk.light[i])
+      ++j;
+
+    vector_resize_push<uint8_t>(runs, chunk.light[i]);
+    chunk_compress_varint(runs, j - i - 1);
+    i = j;
+  }
+  return chunk_compress_finish(runs);
+}
+
+CompressedChunk chunk_compress(const Chunk& chunk)
+{
+  CompressedChunk compressed_chunk = {};
+  compressed_chunk.height     = chunk.height;
+  compressed_chunk.light_runs = chunk_compress_light(chunk);
+
+  const size_t block_count = CHUNK_SIZE * CHUNK_SIZE * chunk.height;
+
+  // Local palette, in the order block types are first seen
+  uint8_t palette_indices[(size_t)BlockType::COUNT];
+  memset(palette_indices, 0xFF, sizeof palette_indices);
+  for(size_t i=0; i<block_count; ++i)
+  {
+    const size_t type = (size_t)chunk.blocks[i];
+    if(palette_indices[type] == 0xFF)
+    {
+      palette_indices[type] = compressed_chunk.palette_size;
+      compressed_chunk.palette[compressed_chunk.palette_size++] = chunk.blocks[i];
+    }
+  }
+
+  const size_t section_count = chunk_section_count(chunk);
+  const size_t section_size  = CHUNK_SIZE * CHUNK_SIZE * CHUNK_SECTION_HEIGHT;
+  compressed_chunk.sections = create_dynarray<CompressedChunkSection>(section_count);
+  for(size_t z=0; z<chunk.height; ++z)
+    if(chunk.occupancy[z] != 0)
+      compressed_chunk.occupied_sections |= uint64_t(1) << (z / CHUNK_SECTION_HEIGHT);
+
+  if(compressed_chunk.palette_size == 0)
+  {
+    compressed_chunk.runs = create_dynarray<uint8_t>(0);
+    return compressed_chunk;
+  }
+
+  const unsigned index_bits = compressed_chunk_index_bits(compressed_chunk.palette_size);
+
+  vector<uint8_t> runs = create_vector<uint8_t>(64);
+  for(size_t i=0, section=0; i<block_count;)
+  {
+    size_t j = i + 1;
+    while(j < block_count && chunk.blocks[j] == chunk.blocks[i])
+      ++j;
+
+    for(; section < section_count && section * section_size < j; ++section)
+    {
+      compressed_chunk.sections[section].run_offset = size(runs);
+      compressed_chunk.sections[section].run_begin  = i;
+    }
+
+    chunk_compress_run(runs, index_bits, palette_indices[(size_t)chunk.blocks[i]], j - i);
+    i = j;
+  }
+
+  compressed_chunk.runs = chunk_compress_finish(runs);
+  return compressed_chunk;
+}
+
+Chunk chunk_decompress(const CompressedChunk& compressed_chunk)
+{
+  Chunk chunk;
+  [[maybe_unused]] const bool valid = chunk_decompress(compressed_chunk.height, compressed_chunk.palette, compressed_chunk.palette_size,
+      data(compressed_chunk.runs), size(compressed_chunk.runs), data(compressed_chunk.light_runs), size(compressed_chunk.light_runs), chunk);
+  assert(valid);
+  return chunk;
+}
+
+// Return false if the varint is cut short or too large for any chunk
+static bool chunk_decompress_varint(const uint8_t *& it, const uint8_t *it_end, size_t& value)
+{
+  value = 0;
+  for(unsigned shift = 0;; shift += 7)
+  {
+    if(it == it_end || shift >= 32)
+      return false;
+
+    const uint8_t byte = *it++;
+    value |= size_t(byte & 0x7F) << shift;
+    if(!(byte & 0x80))
+      return true;
+  }
+}
+
+// Read one run, returning false if it is cut short or longer than the chunk
+static bool chunk_decompress_run(const uint8_t *& it, const uint8_t *it_end, unsigned index_bits, size_t block_count, uint8_t& index, size_t& length)
+{
+  const size_t length_escape = (size_t(1) << (8 - index_bits)) - 1;
+
+  const uint8_t header = *it++;
+  index  = header & ((1u << index_bits) - 1);
+  length = header >> index_bits;
+  if(length == length_escape)
+  {
+    size_t remaining;
+    if(!chunk_decompress_varint(it, it_end, remaining))
+      return false;
+
+    length += remaining;
+  }
+  length += 1;
+  return length <= block_count;
+}
+
+static bool chunk_decompress_light(const uint8_t *it, const uint8_t *it_end, uint8_t *light, size_t block_count)
+{
+  size_t i = 0;
+  while(it != it_end)
+  {
+    const uint8_t level = *it++;
+
+    size_t length;
+    if(!chunk_decompress_varint(it, it_end, length) || length >= block_count - i)
+      return false;
+
+    memset(&light[i], level, length + 1);
+    i += length + 1;
+  }
+  return i == block_count;
+}
+
+bool chunk_decompress(size_t height, const BlockType *palette, size_t palette_size, const uint8_t *runs, size_t runs_size, const uint8_t *light_runs, size_t light_runs_size, Chunk& chunk)
+{
+  if(height > CHUNK_MAX_HEIGHT || palette_size > (size_t)BlockType::COUNT)
+    return false;
+
+  for(size_t i=0; i<palette_size; ++i)
+    if((size_t)palette[i] >= (size_t)BlockType::COUNT)
+      return false;
+
+  Chunk result = chunk_create(height);
+
+  const size_t   block_count = CHUNK_SIZE * CHUNK_SIZE * result.height;
+  const unsigned index_bits  = compressed_chunk_index_bits(palette_size);
+
+  const uint8_t *it     = runs;
+  const uint8_t *it_end = runs + runs_size;
+
+  // Without a palette there can be no runs, and the chunk is left empty
+  bool   valid = palette_size != 0 || runs_size == 0;
+  size_t i     = 0;
+  while(valid && it != it_end)
+  {
+    uint8_t index;
+    size_t  length;
+    valid = chunk_decompress_run(it, it_end, index_bits, block_count - i, index, length) && index < palette_size;
+    if(!valid)
+      break;
+
+    memset(&result.blocks[i], (int)palette[index], length);
+    i += length;
+  }
+  valid = valid && (i == block_count || palette_size == 0);
+  valid = valid && chunk_decompress_light(light_runs, light_runs + light_runs_size, result.light, block_count);
+
+  if(!valid)
+  {
+    chunk_destroy(result);
+    return false;
+  }
+
+  static_assert(sizeof(BlockType) == 1);
+  for(size_t z=0; z<result.height; ++z)
+  {
+    uint64_t layer = 0;
+    for(size_t j=0; j<CHUNK_SIZE * CHUNK_SIZE; ++j)
+      if(result.blocks[z * CHUNK_SIZE * CHUNK_SIZE + j] != BlockType::AIR)
+        layer |= uint64_t(1) << j;
+
+    result.occupancy[z] = layer;
+  }
+
+  chunk = result;
+  return true;
+}
+
+void compressed_chunk_destroy(CompressedChunk& compressed_chunk)
+{
+  destroy_dynarray(compressed_chunk.runs);
+  destroy_dynarray(compressed_chunk.light_runs);
+  destroy_dynarray(compressed_chunk.sections);
+}
+
+BlockType compressed_chunk_get_block(const CompressedChunk& compressed_chunk, size_t x, size_t y, size_t z)
+{
+  assert(x < CHUNK_SIZE && y < CHUNK_SIZE && z < compressed_chunk.height);
+
+  const size_t section = z / CHUNK_SECTION_HEIGHT;
+  if(compressed_chunk_section_empty(compressed_chunk, section))
+    return BlockType::AIR;
+
+  const size_t   block_count = CHUNK_SIZE * CHUNK_SIZE * compressed_chunk.height;
+  const size_t   target      = chunk_block_index(x, y, z);
+  const unsigned index_bits  = compressed_chunk_index_bits(compressed_chunk.palette_size);
+
+  // Runs were produced by chunk_compress and do not need to be validated
+  const uint8_t *it     = data(compressed_chunk.runs) + compressed_chunk.sections[section].run_offset;
+  const uint8_t *it_end = data(compressed_chunk.runs) + size(compressed_chunk.runs);
+  size_t         i      = compressed_chunk.sections[section].run_begin;
+  for(;;)
+  {
+    uint8_t index;
+    size_t  length;
+    [[maybe_unused]] const bool valid = chunk_decompress_run(it, it_end, index_bits, block_count - i, index, length);
+    assert(valid);
+
+    i += length;
+    if(target < i)
+      return compressed_chunk.palette[index];
+  }
+}
+
+size_t compressed_chunk_memory_usage(const CompressedChunk& compressed_chunk)
+{
+  return sizeof compressed_chunk + size(compressed_chunk.runs) + size(compressed_chunk.light_runs) + size(compressed_chunk.sections) * sizeof(CompressedChunkSection);
+}
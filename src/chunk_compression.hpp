@@ -0,0 +1,65 @@
+#pragma once
+
+#include "chunk.hpp"
+#include "utils.hpp"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Compressed representation for chunks that are resident but not being
+// meshed or edited. The block types present in the chunk are gathered into a
+// local palette, and the blocks array is then run-length encoded in storage
+// order. Each run start with a header byte holding the palette index in its
+// low bits and the run length minus one in the remaining bits. If the length
+// does not fit, the remaining bits are all set and the rest of the length
+// follows as a LEB128 varint.
+//
+// Occupancy masks are not stored since they can be recomputed from the
+// blocks when decompressing. Light is, since it depends on the neighbouring
+// chunks at the time it spread, and is run-length encoded separately as a
+// light byte followed by the run length minus one as a LEB128 varint.
+//
+// The run covering the first block of every section is remembered, so that
+// single blocks can be read back by decoding at most one section worth of
+// runs, without decompressing the chunk.
+struct CompressedChunkSection
+{
+  uint32_t run_offset; // Byte offset into runs of the run
+  uint32_t run_begin;  // Index of the first block of the run
+};
+
+struct CompressedChunk
+{
+  size_t height;
+
+  uint8_t   palette_size;
+  BlockType palette[(size_t)BlockType::COUNT];
+
+  dynarray<uint8_t> runs;
+  dynarray<uint8_t> light_runs;
+
+  uint64_t                         occupied_sections; // Sections with any block that is not air
+  dynarray<CompressedChunkSection> sections;
+};
+static_assert(CHUNK_MAX_HEIGHT / CHUNK_SECTION_HEIGHT <= 64);
+
+CompressedChunk chunk_compress(const Chunk& chunk);
+Chunk chunk_decompress(const CompressedChunk& compressed_chunk);
+
+// Decompress from a palette and runs stored elsewhere, such as directly from
+// a memory mapped region file, which is not trusted. Return false, leaving
+// chunk untouched, if the height is too large, the palette holds unknown
+// block types, or the runs use indices outside of the palette or do not
+// cover exactly the blocks of the chunk.
+bool chunk_decompress(size_t height, const BlockType *palette, size_t palette_size, const uint8_t *runs, size_t runs_size, const uint8_t *light_runs, size_t light_runs_size, Chunk& chunk);
+
+void compressed_chunk_destroy(CompressedChunk& compressed_chunk);
+
+inline bool compressed_chunk_section_empty(const CompressedChunk& compressed_chunk, size_t section)
+{
+  return !(compressed_chunk.occupied_sections & (uint64_t(1) << section));
+}
+
+BlockType compressed_chunk_get_block(const CompressedChunk& compressed_chunk, size_t x, size_t y, size_t z);
+
+size_t compressed_chunk_memory_usage(const CompressedChunk& compressed_chunk);
@@ -0,0 +1,273 @@
+#include "chunk_light.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#include <assert.h>
+
+// Channels are named after the shift of their nibble in Chunk::light
+static constexpr unsigned CHUNK_LIGHT_BLOCK = 0;
+static constexpr unsigned CHUNK_LIGHT_SKY   = 4;
+
+// Ordered like the faces, so that offset 4 goes down
+static constexpr glm::ivec3 CHUNK_LIGHT_OFFSETS[6] = {
+  {-1, 0, 0}, {1, 0, 0},
+  {0, -1, 0}, {0, 1, 0},
+  {0, 0, -1}, {0, 0, 1},
+};
+static constexpr size_t CHUNK_LIGHT_DOWN = 4;
+
+// Position of a block in the neighbourhood, with x and y counted from the
+// corner of the center chunk so that they go from -CHUNK_SIZE to
+// 2 * CHUNK_SIZE - 1.
+struct ChunkLightNode
+{
+  glm::ivec3 position;
+  uint8_t    level; // Before it was removed, for the removal queue only
+};
+
+struct ChunkLightCell
+{
+  Chunk  *chunk;
+  size_t  z;
+  size_t  index;
+  size_t  neighbour; // Of the chunk in the neighbourhood
+};
+
+static bool chunk_light_cell(ChunkLightNeighbourhood& neighbourhood, glm::ivec3 position, ChunkLightCell& cell)
+{
+  const int size = (int)CHUNK_SIZE;
+  if(position.x < -size || position.x >= 2 * size || position.y < -size || position.y >= 2 * size || position.z < 0)
+    return false;
+
+  const int dx = position.x < 0 ? -1 : position.x >= size ? 1 : 0;
+  const int dy = position.y < 0 ? -1 : position.y >= size ? 1 : 0;
+
+  const size_t neighbour = (dx + 1) + (dy + 1) * 3;
+  Chunk *chunk = neighbourhood.chunks[neighbour];
+  if(!chunk || (size_t)position.z >= chunk->height)
+    return false;
+
+  cell.chunk     = chunk;
+  cell.z         = position.z;
+  cell.index     = chunk_block_index(position.x - dx * size, position.y - dy * size, position.z);
+  cell.neighbour = neighbour;
+  return true;
+}
+
+static uint8_t chunk_light_get(const ChunkLightCell& cell, unsigned channel)
+{
+  return cell.chunk->light[cell.index] >> channel & CHUNK_LIGHT_MAX;
+}
+
+static void chunk_light_set(ChunkLightNeighbourhood& neighbourhood, glm::ivec3 position, const ChunkLightCell& cell, unsigned channel, uint8_t level)
+{
+  uint8_t& light = cell.chunk->light[cell.index];
+  const uint8_t previous = light;
+  light = (uint8_t)((light & ~(CHUNK_LIGHT_MAX << channel)) | level << channel);
+  chunk_mark_dirty(*cell.chunk, cell.z);
+  if(light != previous)
+    neighbourhood.changed |= 1 << cell.neighbour;
+
+  // Faces across the border are lit by the block too
+  for(size_t offset=0; offset<4; ++offset)
+  {
+    ChunkLightCell neighbour;
+    if(chunk_light_cell(neighbourhood, position + CHUNK_LIGHT_OFFSETS[offset], neighbour) && neighbour.chunk != cell.chunk)
+      chunk_mark_dirty(*neighbour.chunk, neighbour.z);
+  }
+}
+
+static bool chunk_light_opaque(const ChunkLightCell& cell)
+{
+  return cell.chunk->blocks[cell.index] != BlockType::AIR;
+}
+
+static uint8_t chunk_light_emission(BlockType type, unsigned channel)
+{
+  return channel == CHUNK_LIGHT_BLOCK && type == BlockType::LAMP ? CHUNK_LIGHT_MAX : 0;
+}
+
+// Level reached by light of the given level after one step toward offset
+static uint8_t chunk_light_spread(unsigned channel, uint8_t level, size_t offset)
+{
+  if(channel == CHUNK_LIGHT_SKY && offset == CHUNK_LIGHT_DOWN && level == CHUNK_LIGHT_MAX)
+    return CHUNK_LIGHT_MAX;
+
+  return level != 0 ? level - 1 : 0;
+}
+
+// Flood fill from the blocks in queue, which are already lit, and empty it.
+// Blocks are only ever lit more brightly so each is visited a bounded number
+// of times.
+static void chunk_light_add(ChunkLightNeighbourhood& neighbourhood, unsigned channel, vector<ChunkLightNode>& queue)
+{
+  for(size_t head=0; head<size(queue); ++head)
+  {
+    const glm::ivec3 position = queue.data[head].position;
+
+    ChunkLightCell cell;
+    if(!chunk_light_cell(neighbourhood, position, cell))
+      continue;
+
+    const uint8_t level = chunk_light_get(cell, channel);
+    for(size_t offset=0; offset<6; ++offset)
+    {
+      const uint8_t spread = chunk_light_spread(channel, level, offset);
+      if(spread == 0)
+        continue;
+
+      const glm::ivec3 neighbour_position = position + CHUNK_LIGHT_OFFSETS[offset];
+
+      ChunkLightCell neighbour;
+      if(!chunk_light_cell(neighbourhood, neighbour_position, neighbour) || chunk_light_opaque(neighbour) || chunk_light_get(neighbour, channel) >= spread)
+        continue;
+
+      chunk_light_set(neighbourhood, neighbour_position, neighbour, channel, spread);
+      vector_resize_push(queue, ChunkLightNode{ neighbour_position, 0 });
+    }
+  }
+  queue.size = 0;
+}
+
+// Darken every block that may have been lit by the blocks in removal, which
+// are already dark, and empty it. Blocks that are lit by something else are
+// left as is and pushed to add instead, so that their light spread back into
+// the darkened area afterward.
+static void chunk_light_remove(ChunkLightNeighbourhood& neighbourhood, unsigned channel, vector<ChunkLightNode>& removal, vector<ChunkLightNode>& add)
+{
+  for(size_t head=0; head<size(removal); ++head)
+  {
+    const ChunkLightNode node = removal.data[head];
+    for(size_t offset=0; offset<6; ++offset)
+    {
+      const glm::ivec3 neighbour_position = node.position + CHUNK_LIGHT_OFFSETS[offset];
+
+      ChunkLightCell neighbour;
+      if(!chunk_light_cell(neighbourhood, neighbour_position, neighbour))
+        continue;
+
+      const uint8_t level = chunk_light_get(neighbour, channel);
+      if(level == 0)
+        continue;
+
+      if(level <= chunk_light_spread(channel, node.level, offset))
+      {
+        const uint8_t emission = chunk_light_emission(neighbour.chunk->blocks[neighbour.index], channel);
+        chunk_light_set(neighbourhood, neighbour_position, neighbour, channel, emission);
+        vector_resize_push(removal, ChunkLightNode{ neighbour_position, level });
+        if(emission != 0)
+          vector_resize_push(add, ChunkLightNode{ neighbour_position, 0 });
+      }
+      else
+      {
+        vector_resize_push(add, ChunkLightNode{ neighbour_position, 0 });
+      }
+    }
+  }
+  removal.size = 0;
+}
+
+void chunk_light_init(Chunk& chunk)
+{
+  const uint64_t dirty_sections = chunk.dirty_sections;
+  std::fill_n(chunk.light, CHUNK_SIZE * CHUNK_SIZE * chunk.height, 0);
+
+  ChunkLightNeighbourhood neighbourhood = {};
+  neighbourhood.chunks[4] = &chunk;
+
+  vector<ChunkLightNode> queue = create_vector<ChunkLightNode>(256);
+
+  // Columns stay open to the sky from the top down to their first solid
+  // block. Only open blocks next to air in the shade need to spread their
+  // light, the others are surrounded by full skylight or solid blocks.
+  uint64_t open = ~uint64_t(0);
+  for(size_t z=chunk.height; z-- > 0;)
+  {
+    const uint64_t air   = ~chunk.occupancy[z];
+    open &= air;
+
+    const uint64_t shade = air & ~open;
+    const uint64_t seeds = open & (((shade >> 1) & ~LAYER_COLUMN_LAST) | ((shade << 1) & ~LAYER_COLUMN_FIRST) | shade >> CHUNK_SIZE | shade << CHUNK_SIZE);
+
+    for(uint64_t remaining = open; remaining != 0; remaining &= remaining - 1)
+      chunk.light[z * CHUNK_SIZE * CHUNK_SIZE + std::countr_zero(remaining)] = CHUNK_LIGHT_SKY_FULL;
+
+    for(uint64_t remaining = seeds; remaining != 0; remaining &= remaining - 1)
+    {
+      const int j = std::countr_zero(remaining);
+      vector_resize_push(queue, ChunkLightNode{ glm::ivec3(j % CHUNK_SIZE, j / CHUNK_SIZE, z), 0 });
+    }
+  }
+  chunk_light_add(neighbourhood, CHUNK_LIGHT_SKY, queue);
+
+  for(size_t z=0; z<chunk.height; ++z)
+    for(uint64_t remaining = chunk.occupancy[z]; remaining != 0; remaining &= remaining - 1)
+    {
+      const int j = std::countr_zero(remaining);
+      const size_t i = z * CHUNK_SIZE * CHUNK_SIZE + j;
+
+      const uint8_t emission = chunk_light_emission(chunk.blocks[i], CHUNK_LIGHT_BLOCK);
+      if(emission == 0)
+        continue;
+
+      chunk.light[i] |= emission << CHUNK_LIGHT_BLOCK;
+      vector_resize_push(queue, ChunkLightNode{ glm::ivec3(j % CHUNK_SIZE, j / CHUNK_SIZE, z), 0 });
+    }
+  chunk_light_add(neighbourhood, CHUNK_LIGHT_BLOCK, queue);
+
+  destroy_vector(queue);
+  chunk.dirty_sections = dirty_sections;
+}
+
+void chunk_light_update(ChunkLightNeighbourhood& neighbourhood, size_t x, size_t y, size_t z, BlockType previous)
+{
+  Chunk& chunk = *neighbourhood.chunks[4];
+  assert(x < CHUNK_SIZE && y < CHUNK_SIZE && z < chunk.height);
+
+  const glm::ivec3 position = glm::ivec3(x, y, z);
+  const ChunkLightCell cell = { &chunk, z, chunk_block_index(x, y, z), 4 };
+
+  neighbourhood.changed = 0;
+  const BlockType type = chunk.blocks[cell.index];
+  if(type == previous)
+    return;
+
+  vector<ChunkLightNode> removal = create_vector<ChunkLightNode>(64);
+  vector<ChunkLightNode> add     = create_vector<ChunkLightNode>(64);
+  for(unsigned channel : { CHUNK_LIGHT_SKY, CHUNK_LIGHT_BLOCK })
+  {
+    // Remove whatever the block used to let through or emit
+    const uint8_t level = chunk_light_get(cell, channel);
+    if(level != 0)
+    {
+      chunk_light_set(neighbourhood, position, cell, channel, 0);
+      vector_resize_push(removal, ChunkLightNode{ position, level });
+      chunk_light_remove(neighbourhood, channel, removal, add);
+    }
+
+    // Let the light of the neighbours in, including the sky above the chunk
+    if(type == BlockType::AIR)
+    {
+      for(size_t offset=0; offset<6; ++offset)
+        vector_resize_push(add, ChunkLightNode{ position + CHUNK_LIGHT_OFFSETS[offset], 0 });
+
+      if(channel == CHUNK_LIGHT_SKY && z + 1 == chunk.height)
+      {
+        chunk_light_set(neighbourhood, position, cell, channel, CHUNK_LIGHT_MAX);
+        vector_resize_push(add, ChunkLightNode{ position, 0 });
+      }
+    }
+
+    const uint8_t emission = chunk_light_emission(type, channel);
+    if(emission != 0)
+    {
+      chunk_light_set(neighbourhood, position, cell, channel, emission);
+      vector_resize_push(add, ChunkLightNode{ position, 0 });
+    }
+
+    chunk_light_add(neighbourhood, channel, add);
+  }
+  destroy_vector(removal);
+  destroy_vector(add);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "chunk.hpp"
+
+#include <stddef.h>
+
+// Skylight and block light, stored per block in Chunk::light and baked into
+// the vertices of the faces in front of them.
+//
+// Skylight comes down from above the chunk at full strength until it hits a
+// solid block, and block light comes out of emitting blocks such as lamps.
+// Both then spread to neighbouring air blocks with a flood fill, losing one
+// level per block, except for full skylight going straight down. Solid blocks
+// are opaque and keep no light of their own, other than what they emit.
+//
+// Light spreads across chunks, but only through the chunks that are handed
+// over. Missing chunks block it, as if their blocks were all opaque.
+struct ChunkLightNeighbourhood
+{
+  Chunk    *chunks[9]; // Indexed by (dx + 1) + (dy + 1) * 3, chunk 4 being the center, nullptr if missing
+  uint16_t  changed;   // Bit i set by chunk_light_update if the light of chunks[i] changed
+};
+
+// Light chunk from scratch, on its own. Only light coming from the chunk
+// itself is taken into account, and the dirty sections are left as is.
+void chunk_light_init(Chunk& chunk);
+
+// Update the light around the block at (x, y, z) in the center chunk after it
+// changed from previous to its current type, removing the light it used to
+// let through or emit before spreading the new one. Sections whose light
+// changed are marked as dirty in whichever chunk they belong to, and so are
+// the chunks themselves in neighbourhood.changed.
+void chunk_light_update(ChunkLightNeighbourhood& neighbourhood, size_t x, size_t y, size_t z, BlockType previous);
@@ -0,0 +1,72 @@
+#include "chunk_mesh_cache.hpp"
+
+void chunk_mesh_cache_init(ChunkMeshCache& cache, size_t budget)
+{
+  cache.budget       = budget;
+  cache.memory_usage = 0;
+  ll_init(&cache.lru);
+}
+
+static void chunk_mesh_cache_evict(ChunkMeshCache& cache, ChunkMeshCacheEntry *entry)
+{
+  ll_remove(&entry->node);
+  cache.entries.erase(entry->key);
+  cache.memory_usage -= entry->memory_usage;
+
+  chunk_mesh_destroy(entry->mesh);
+  delete entry;
+}
+
+void chunk_mesh_cache_deinit(ChunkMeshCache& cache)
+{
+  while(!ll_empty(&cache.lru))
+    chunk_mesh_cache_evict(cache, container_of(ll_front(&cache.lru), ChunkMeshCacheEntry, node));
+}
+
+uint64_t chunk_mesh_cache_key(const Chunk& chunk, const ChunkNeighbours& neighbours, ChunkMeshMode mode, size_t lod)
+{
+  // The same blocks give different meshes next to different neighbours, and
+  // in different modes and levels of detail
+  const uint64_t hash = chunk_hash(chunk) ^ chunk_neighbours_hash(neighbours) * 0xc4ceb9fe1a85ec53;
+  return hash ^ ((uint64_t)mode << 8 | (uint64_t)lod) * 0xff51afd7ed558ccd;
+}
+
+bool chunk_mesh_cache_find(ChunkMeshCache& cache, uint64_t key, ChunkMesh& mesh)
+{
+  auto it = cache.entries.find(key);
+  if(it == cache.entries.end())
+    return false;
+
+  ChunkMeshCacheEntry *entry = it->second;
+  ll_remove(&entry->node);
+  ll_prepend(&cache.lru, &entry->node);
+
+  mesh = chunk_mesh_share(entry->mesh);
+  return true;
+}
+
+void chunk_mesh_cache_insert(ChunkMeshCache& cache, uint64_t key, const ChunkMesh& mesh)
+{
+  if(!mesh.mesh || cache.entries.contains(key))
+    return;
+
+  ChunkMeshCacheEntry *entry = new ChunkMeshCacheEntry{};
+  entry->key          = key;
+  entry->mesh         = chunk_mesh_share(mesh);
+  entry->memory_usage = chunk_mesh_memory_usage(mesh);
+
+  ll_prepend(&cache.lru, &entry->node);
+  cache.entries.emplace(key, entry);
+  cache.memory_usage += entry->memory_usage;
+
+  // Never evict what was just inserted, even if it is over budget on its own
+  while(cache.memory_usage > cache.budget && ll_back(&cache.lru) != &entry->node)
+    chunk_mesh_cache_evict(cache, container_of(ll_back(&cache.lru), ChunkMeshCacheEntry, node));
+}
+
+void chunk_mesh_cache_remove(ChunkMeshCache& cache, uint64_t key, const ChunkMesh& mesh)
+{
+  auto it = cache.entries.find(key);
+  if(it != cache.entries.end() && it->second->mesh.mesh == mesh.mesh)
+    chunk_mesh_cache_evict(cache, it->second);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "chunk.hpp"
+#include "utils/ll.hpp"
+
+#include <unordered_map>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Cache of uploaded chunk meshes keyed by the content they were built from,
+// so that chunks meshed again with the same blocks, such as chunks coming
+// back into range or switching back to a previous level of detail, reuse the
+// existing GPU mesh instead of allocating and uploading a new one.
+//
+// Keys are 64-bit hashes and are trusted without comparing the blocks, which
+// would defeat the purpose of keeping the cache small.
+//
+// The cache holds a reference to every mesh it contains. Meshes are evicted
+// least recently used first once the total memory they use exceed the
+// budget, whether or not they are still used elsewhere, which only drops the
+// reference of the cache.
+struct ChunkMeshCacheEntry
+{
+  struct ll_node node;
+
+  uint64_t  key;
+  ChunkMesh mesh;
+  size_t    memory_usage;
+};
+
+struct ChunkMeshCache
+{
+  size_t budget;
+  size_t memory_usage;
+
+  struct ll lru; // Most recently used first
+  std::unordered_map<uint64_t, ChunkMeshCacheEntry *> entries;
+};
+
+void chunk_mesh_cache_init(ChunkMeshCache& cache, size_t budget);
+void chunk_mesh_cache_deinit(ChunkMeshCache& cache);
+
+uint64_t chunk_mesh_cache_key(const Chunk& chunk, const ChunkNeighbours& neighbours, ChunkMeshMode mode, size_t lod);
+
+// On a hit, set mesh to a new reference to the cached mesh, which then must
+// be destroyed with chunk_mesh_destroy as usual.
+bool chunk_mesh_cache_find(ChunkMeshCache& cache, uint64_t key, ChunkMesh& mesh);
+
+// Add a reference to mesh to the cache, unless the key is already present.
+// Empty meshes are not worth caching and are ignored.
+void chunk_mesh_cache_insert(ChunkMeshCache& cache, uint64_t key, const ChunkMesh& mesh);
+
+// Drop the reference of the cache to mesh if it is cached under key, so that
+// it can be updated in place once no one else shares it.
+void chunk_mesh_cache_remove(ChunkMeshCache& cache, uint64_t key, const ChunkMesh& mesh);
@@ -0,0 +1,178 @@
+#include "chunk_mesher.hpp"
+
+#include <algorithm>
+
+struct ChunkMeshJob
+{
+  struct ll_node node;
+
+  const Chunk           *chunk;
+  const ChunkNeighbours *neighbours;
+  ChunkMeshMode          mode;
+  size_t         lod;
+  void          *data;
+
+  // If set, chunk is generated from the terrain before being meshed
+  Chunk      *generate;
+  uint32_t    seed;
+  glm::ivec2  coord;
+
+  ChunkMeshData mesh_data;
+};
+
+static void chunk_mesher_work(ChunkMesher& mesher)
+{
+  std::unique_lock<std::mutex> lock(mesher.mutex);
+  for(;;)
+  {
+    mesher.pending_cv.wait(lock, [&]() { return mesher.stopping || !ll_empty(&mesher.pending); });
+    if(mesher.stopping)
+      return;
+
+    struct ll_node *node = ll_front(&mesher.pending);
+    ll_remove(node);
+
+    // Generating and meshing are the only parts done without holding the lock
+    lock.unlock();
+    ChunkMeshJob *job = container_of(node, ChunkMeshJob, node);
+    if(job->generate)
+    {
+      *job->generate = terrain_generate(job->seed, job->coord);
+      chunk_light_init(*job->generate);
+    }
+    if(job->lod == 0)
+    {
+      job->mesh_data = chunk_generate_mesh_data(*job->chunk, *job->neighbours, job->mode);
+    }
+    else
+    {
+      Chunk downsampled = chunk_downsample(*job->chunk, job->lod);
+      chunk_light_init(downsampled);
+      job->mesh_data = chunk_generate_mesh_data(downsampled, ChunkNeighbours{}, job->mode);
+      chunk_destroy(downsampled);
+    }
+    lock.lock();
+
+    ll_append(&mesher.completed, &job->node);
+    mesher.completed_cv.notify_one();
+  }
+}
+
+void chunk_mesher_init(ChunkMesher& mesher, size_t worker_count)
+{
+  if(worker_count == 0)
+    worker_count = std::max(std::thread::hardware_concurrency(), 1u);
+
+  ll_init(&mesher.pending);
+  ll_init(&mesher.completed);
+  mesher.in_flight = 0;
+  mesher.stopping  = false;
+
+  mesher.workers      = new std::thread[worker_count];
+  mesher.worker_count = worker_count;
+  for(size_t i=0; i<worker_count; ++i)
+    mesher.workers[i] = std::thread(chunk_mesher_work, std::ref(mesher));
+}
+
+static void chunk_mesher_free_jobs(struct ll *jobs)
+{
+  while(!ll_empty(jobs))
+  {
+    struct ll_node *node = ll_front(jobs);
+    ll_remove(node);
+
+    ChunkMeshJob *job = container_of(node, ChunkMeshJob, node);
+    if(job->mesh_data.vertices.data)
+      chunk_mesh_data_destroy(job->mesh_data);
+
+    delete job;
+  }
+}
+
+void chunk_mesher_deinit(ChunkMesher& mesher)
+{
+  {
+    std::lock_guard<std::mutex> lock(mesher.mutex);
+    mesher.stopping = true;
+  }
+  mesher.pending_cv.notify_all();
+
+  for(size_t i=0; i<mesher.worker_count; ++i)
+    mesher.workers[i].join();
+
+  delete[] mesher.workers;
+  mesher.workers      = nullptr;
+  mesher.worker_count = 0;
+
+  chunk_mesher_free_jobs(&mesher.pending);
+  chunk_mesher_free_jobs(&mesher.completed);
+  mesher.in_flight = 0;
+}
+
+static void chunk_mesher_push(ChunkMesher& mesher, ChunkMeshJob *job)
+{
+  {
+    std::lock_guard<std::mutex> lock(mesher.mutex);
+    ll_append(&mesher.pending, &job->node);
+    ++mesher.in_flight;
+  }
+  mesher.pending_cv.notify_one();
+}
+
+void chunk_mesher_submit(ChunkMesher& mesher, const Chunk& chunk, const ChunkNeighbours& neighbours, ChunkMeshMode mode, size_t lod, void *data)
+{
+  ChunkMeshJob *job = new ChunkMeshJob{};
+  job->chunk      = &chunk;
+  job->neighbours = &neighbours;
+  job->mode       = mode;
+  job->lod        = lod;
+  job->data       = data;
+  chunk_mesher_push(mesher, job);
+}
+
+void chunk_mesher_submit_generate(ChunkMesher& mesher, Chunk& chunk, const ChunkNeighbours& neighbours, uint32_t seed, glm::ivec2 coord, ChunkMeshMode mode, size_t lod, void *data)
+{
+  ChunkMeshJob *job = new ChunkMeshJob{};
+  job->chunk      = &chunk;
+  job->neighbours = &neighbours;
+  job->mode       = mode;
+  job->lod        = lod;
+  job->data       = data;
+  job->generate   = &chunk;
+  job->seed       = seed;
+  job->coord      = coord;
+  chunk_mesher_push(mesher, job);
+}
+
+static void chunk_mesher_take(ChunkMesher& mesher, ChunkMeshResult& result)
+{
+  struct ll_node *node = ll_front(&mesher.completed);
+  ll_remove(node);
+  --mesher.in_flight;
+
+  ChunkMeshJob *job = container_of(node, ChunkMeshJob, node);
+  result.data      = job->data;
+  result.mesh_data = job->mesh_data;
+  delete job;
+}
+
+bool chunk_mesher_poll(ChunkMesher& mesher, ChunkMeshResult& result)
+{
+  std::lock_guard<std::mutex> lock(mesher.mutex);
+  if(ll_empty(&mesher.completed))
+    return false;
+
+  chunk_mesher_take(mesher, result);
+  return true;
+}
+
+bool chunk_mesher_wait(ChunkMesher& mesher, ChunkMeshResult& result)
+{
+  std::unique_lock<std::mutex> lock(mesher.mutex);
+  if(mesher.in_flight == 0)
+    return false;
+
+  mesher.completed_cv.wait(lock, [&]() { return !ll_empty(&mesher.completed); });
+  chunk_mesher_take(mesher, result);
+  return true;
+}
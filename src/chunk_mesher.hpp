@@ -0,0 +1,61 @@
+#pragma once
+
+#include "chunk.hpp"
+#include "chunk_light.hpp"
+#include "terrain.hpp"
+#include "utils/ll.hpp"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Pool of worker threads generating chunk meshes in the background. Only the
+// CPU side of the mesh is generated by the workers, uploading the result with
+// chunk_mesh_data_upload is left to the thread owning the command buffer.
+//
+// A chunk, and the neighbours it is meshed with, must not be modified or
+// destroyed until the result of every job submitted for it has been polled.
+struct ChunkMesher
+{
+  std::mutex              mutex;
+  std::condition_variable pending_cv;
+  std::condition_variable completed_cv;
+
+  struct ll pending;
+  struct ll completed;
+  size_t    in_flight; // Submitted but not yet polled
+  bool      stopping;
+
+  std::thread *workers;
+  size_t       worker_count;
+};
+
+struct ChunkMeshResult
+{
+  void         *data;
+  ChunkMeshData mesh_data;
+};
+
+// A worker_count of 0 use one worker per hardware thread.
+void chunk_mesher_init(ChunkMesher& mesher, size_t worker_count = 0);
+void chunk_mesher_deinit(ChunkMesher& mesher);
+
+// The chunk is meshed at the given level of detail, see chunk_downsample.
+// Neighbours are only looked at for the full level of detail, lower levels
+// are always meshed as if they had none. data is handed back untouched in
+// the corresponding ChunkMeshResult.
+void chunk_mesher_submit(ChunkMesher& mesher, const Chunk& chunk, const ChunkNeighbours& neighbours, ChunkMeshMode mode, size_t lod, void *data);
+
+// Same as chunk_mesher_submit but the worker first fill chunk with
+// terrain_generate(seed, coord), so that generation is done in the
+// background too. chunk must not be valid yet and is only valid once the
+// result has been polled.
+void chunk_mesher_submit_generate(ChunkMesher& mesher, Chunk& chunk, const ChunkNeighbours& neighbours, uint32_t seed, glm::ivec2 coord, ChunkMeshMode mode, size_t lod, void *data);
+
+// Retrieve a finished job without blocking. Returns false if none is ready.
+// The caller owns result.mesh_data and must destroy it.
+bool chunk_mesher_poll(ChunkMesher& mesher, ChunkMeshResult& result);
+
+// Block until a job is finished, unless there is no job in flight in which
+// case false is returned immediately.
+bool chunk_mesher_wait(ChunkMesher& mesher, ChunkMeshResult& result);
@@ -0,0 +1,161 @@
+#include "chunk_octree.hpp"
+
+#include <assert.h>
+
+static_assert(CHUNK_SIZE == CHUNK_SECTION_HEIGHT, "Sections must be cubes to be the root of an octree");
+static_assert((size_t)BlockType::COUNT <= CHUNK_OCTREE_UNIFORM, "Block types must fit in a child");
+
+// A full octree over a section of n blocks has (n - 1) / 7 nodes, one per
+// group of 8 children at every level, and node indices run from 0 up to the
+// total for every section of the tallest chunk.
+static constexpr size_t CHUNK_OCTREE_SECTION_BLOCKS = CHUNK_SIZE * CHUNK_SIZE * CHUNK_SECTION_HEIGHT;
+static constexpr size_t CHUNK_OCTREE_MAX_NODES      = CHUNK_MAX_HEIGHT / CHUNK_SECTION_HEIGHT * ((CHUNK_OCTREE_SECTION_BLOCKS - 1) / 7);
+static_assert(CHUNK_OCTREE_MAX_NODES <= CHUNK_OCTREE_UNIFORM, "Node indices must fit in a child");
+
+static uint16_t chunk_octree_uniform(BlockType type)
+{
+  return CHUNK_OCTREE_UNIFORM | (uint16_t)type;
+}
+
+// Build the cube of the given width with its lowest corner at (x, y, z) and
+// return the child referencing it.
+static uint16_t chunk_octree_build(const Chunk& chunk, vector<ChunkOctreeNode>& nodes, size_t x, size_t y, size_t z, size_t width)
+{
+  if(width == 1)
+    return chunk_octree_uniform(z < chunk.height ? chunk_get_block(chunk, x, y, z) : BlockType::AIR);
+
+  const size_t half = width / 2;
+
+  ChunkOctreeNode node;
+  for(size_t i=0; i<8; ++i)
+    node.children[i] = chunk_octree_build(chunk, nodes, x + (i & 1) * half, y + (i >> 1 & 1) * half, z + (i >> 2) * half, half);
+
+  // Collapse the node if all of its children are the same uniform cube
+  bool uniform = node.children[0] & CHUNK_OCTREE_UNIFORM;
+  for(size_t i=1; i<8; ++i)
+    uniform &= node.children[i] == node.children[0];
+
+  if(uniform)
+    return node.children[0];
+
+  const uint16_t index = (uint16_t)size(nodes);
+  vector_resize_push(nodes, node);
+  return index;
+}
+
+ChunkOctree chunk_octree_create(const Chunk& chunk)
+{
+  ChunkOctree octree = {};
+  octree.height   = chunk.height;
+  octree.sections = create_dynarray<uint16_t>(chunk_section_count(chunk));
+
+  vector<ChunkOctreeNode> nodes = create_vector<ChunkOctreeNode>(64);
+  for(size_t section=0; section<size(octree.sections); ++section)
+    octree.sections[section] = chunk_octree_build(chunk, nodes, 0, 0, section * CHUNK_SECTION_HEIGHT, CHUNK_SECTION_HEIGHT);
+
+  // Shrink to fit since the whole point is to save memory
+  octree.nodes = create_dynarray<ChunkOctreeNode>(size(nodes));
+  std::copy_n(data(nodes), size(nodes), data(octree.nodes));
+  destroy_vector(nodes);
+
+  return octree;
+}
+
+static void chunk_octree_fill(const ChunkOctree& octree, Chunk& chunk, uint16_t child, size_t x, size_t y, size_t z, size_t width)
+{
+  if(child & CHUNK_OCTREE_UNIFORM)
+  {
+    const BlockType type = (BlockType)(child & ~CHUNK_OCTREE_UNIFORM);
+    if(type == BlockType::AIR)
+      return;
+
+    for(size_t dz=0; dz<width && z + dz < chunk.height; ++dz)
+      for(size_t dy=0; dy<width; ++dy)
+        for(size_t dx=0; dx<width; ++dx)
+          chunk_set_block(chunk, x + dx, y + dy, z + dz, type);
+    return;
+  }
+
+  const size_t half = width / 2;
+
+  const ChunkOctreeNode& node = octree.nodes[child];
+  for(size_t i=0; i<8; ++i)
+    chunk_octree_fill(octree, chunk, node.children[i], x + (i & 1) * half, y + (i >> 1 & 1) * half, z + (i >> 2) * half, half);
+}
+
+Chunk chunk_octree_expand(const ChunkOctree& octree)
+{
+  Chunk chunk = chunk_create(octree.height);
+  for(size_t section=0; section<size(octree.sections); ++section)
+    chunk_octree_fill(octree, chunk, octree.sections[section], 0, 0, section * CHUNK_SECTION_HEIGHT, CHUNK_SECTION_HEIGHT);
+
+  chunk.dirty_sections = 0;
+  return chunk;
+}
+
+void chunk_octree_destroy(ChunkOctree& octree)
+{
+  destroy_dynarray(octree.sections);
+  destroy_dynarray(octree.nodes);
+}
+
+BlockType chunk_octree_get_block(const ChunkOctree& octree, size_t x, size_t y, size_t z)
+{
+  assert(x < CHUNK_SIZE && y < CHUNK_SIZE && z < octree.height);
+
+  uint16_t child = octree.sections[z / CHUNK_SECTION_HEIGHT];
+  z %= CHUNK_SECTION_HEIGHT;
+
+  // Bits of the coordinates pick the child at each level, most significant first
+  for(size_t half = CHUNK_SECTION_HEIGHT / 2; !(child & CHUNK_OCTREE_UNIFORM); half /= 2)
+  {
+    const size_t i = (x & half ? 1 : 0) | (y & half ? 2 : 0) | (z & half ? 4 : 0);
+    child = octree.nodes[child].children[i];
+  }
+  return (BlockType)(child & ~CHUNK_OCTREE_UNIFORM);
+}
+
+static bool chunk_octree_is_empty(const ChunkOctree& octree, uint16_t child, glm::ivec3 position, int width, glm::ivec3 begin, glm::ivec3 end)
+{
+  // Disjoint from the region
+  for(int axis=0; axis<3; ++axis)
+    if(position[axis] >= end[axis] || position[axis] + width <= begin[axis])
+      return true;
+
+  if(child & CHUNK_OCTREE_UNIFORM)
+    return (BlockType)(child & ~CHUNK_OCTREE_UNIFORM) == BlockType::AIR;
+
+  const int half = width / 2;
+
+  const ChunkOctreeNode& node = octree.nodes[child];
+  for(int i=0; i<8; ++i)
+    if(!chunk_octree_is_empty(octree, node.children[i], position + glm::ivec3(i & 1, i >> 1 & 1, i >> 2) * half, half, begin, end))
+      return false;
+
+  return true;
+}
+
+bool chunk_octree_is_empty(const ChunkOctree& octree, glm::ivec3 begin, glm::ivec3 end)
+{
+  begin = glm::max(begin, glm::ivec3(0));
+  end   = glm::min(end, glm::ivec3(CHUNK_SIZE, CHUNK_SIZE, octree.height));
+  for(int axis=0; axis<3; ++axis)
+    if(begin[axis] >= end[axis])
+      return true;
+
+  // Only visit the sections overlapping the region
+  const size_t section_begin = begin.z / CHUNK_SECTION_HEIGHT;
+  const size_t section_end   = (end.z + CHUNK_SECTION_HEIGHT - 1) / CHUNK_SECTION_HEIGHT;
+  for(size_t section=section_begin; section<section_end; ++section)
+  {
+    const glm::ivec3 position = glm::ivec3(0, 0, section * CHUNK_SECTION_HEIGHT);
+    if(!chunk_octree_is_empty(octree, octree.sections[section], position, CHUNK_SECTION_HEIGHT, begin, end))
+      return false;
+  }
+  return true;
+}
+
+size_t chunk_octree_memory_usage(const ChunkOctree& octree)
+{
+  return sizeof octree + size(octree.sections) * sizeof(uint16_t) + size(octree.nodes) * sizeof(ChunkOctreeNode);
+}
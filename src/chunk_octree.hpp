@@ -0,0 +1,59 @@
+#pragma once
+
+#include "chunk.hpp"
+#include "utils.hpp"
+
+#include <glm/glm.hpp>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Sparse voxel octree representation for chunks that are mostly air, such as
+// tall chunks with a thin layer of terrain at the bottom. Each section is the
+// root of its own octree, with one level per halving of its size down to
+// single blocks. A child is either a uniform cube, stored inline as its block
+// type, or the index of a node with 8 children of its own. Cubes made of a
+// single block type, including whole sections of air, thus cost nothing
+// beyond the child referencing them.
+//
+// Blocks are queried through the same interface as the flat blocks array of
+// Chunk, and whole regions can be tested for emptiness without visiting the
+// blocks inside of uniform cubes.
+//
+// ChunkWorld does not use it, since chunks at rest are already kept run-length
+// compressed and read in place, and terrain is not tall enough for the octree
+// to pay off. bench/chunk_octree.cpp measures where it would.
+static constexpr uint16_t CHUNK_OCTREE_UNIFORM = 0x8000; // Set if the child is a uniform cube of the block type in the low bits
+
+struct ChunkOctreeNode
+{
+  uint16_t children[8]; // Indexed by x | y << 1 | z << 2, each bit set for the upper half along that axis
+};
+
+struct ChunkOctree
+{
+  size_t height;
+
+  dynarray<uint16_t>        sections; // Root of each section
+  dynarray<ChunkOctreeNode> nodes;
+};
+
+// Layers above the height of a chunk that is not a multiple of the section
+// height are stored as air.
+ChunkOctree chunk_octree_create(const Chunk& chunk);
+Chunk chunk_octree_expand(const ChunkOctree& octree);
+void chunk_octree_destroy(ChunkOctree& octree);
+
+BlockType chunk_octree_get_block(const ChunkOctree& octree, size_t x, size_t y, size_t z);
+
+inline bool chunk_octree_is_solid(const ChunkOctree& octree, size_t x, size_t y, size_t z)
+{
+  return chunk_octree_get_block(octree, x, y, z) != BlockType::AIR;
+}
+
+// True if every block in [begin, end) is air. The region is clipped to the
+// chunk, outside of which everything is considered air.
+bool chunk_octree_is_empty(const ChunkOctree& octree, glm::ivec3 begin, glm::ivec3 end);
+
+// Memory used by the octree in bytes, to compare with chunk_memory_usage
+size_t chunk_octree_memory_usage(const ChunkOctree& octree);
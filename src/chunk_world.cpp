@@ -0,0 +1,862 @@
+#include "chunk_world.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+
+static constexpr float CHUNK_WORLD_CHUNK_WIDTH = CHUNK_SIZE * BLOCK_WIDTH;
+
+glm::ivec2 chunk_world_coord(glm::vec3 position)
+{
+  return glm::ivec2(
+    (int)floorf(position.x / CHUNK_WORLD_CHUNK_WIDTH),
+    (int)floorf(position.y / CHUNK_WORLD_CHUNK_WIDTH)
+  );
+}
+
+glm::vec3 chunk_world_origin(glm::ivec2 coord)
+{
+  return glm::vec3(coord.x * CHUNK_WORLD_CHUNK_WIDTH, coord.y * CHUNK_WORLD_CHUNK_WIDTH, 0.0f);
+}
+
+static size_t chunk_world_slot_index(glm::ivec2 coord)
+{
+  const int width = CHUNK_WORLD_WIDTH;
+  const int x = ((coord.x % width) + width) % width;
+  const int y = ((coord.y % width) + width) % width;
+  return y * width + x;
+}
+
+static ChunkSlot& chunk_world_slot(ChunkWorld& world, glm::ivec2 coord)
+{
+  return world.slots[chunk_world_slot_index(coord)];
+}
+
+static const ChunkSlot& chunk_world_slot(const ChunkWorld& world, glm::ivec2 coord)
+{
+  return world.slots[chunk_world_slot_index(coord)];
+}
+
+static bool chunk_world_in_range(const ChunkWorld& world, glm::ivec2 coord)
+{
+  return std::abs(coord.x - world.center.x) <= CHUNK_WORLD_RADIUS
+      && std::abs(coord.y - world.center.y) <= CHUNK_WORLD_RADIUS;
+}
+
+static size_t chunk_world_lod(const ChunkWorld& world, glm::ivec2 coord)
+{
+  const glm::ivec2 distance = glm::abs(coord - world.center);
+  return (size_t)std::clamp(std::max(distance.x, distance.y) - CHUNK_WORLD_LOD_RADIUS, 0, (int)CHUNK_LOD_COUNT - 1);
+}
+
+static void chunk_slot_clear(ChunkSlot& slot)
+{
+  if(slot.state == ChunkSlotState::EMPTY)
+    return;
+
+  if(slot.compressed)
+    compressed_chunk_destroy(slot.compressed_chunk);
+  else
+    chunk_destroy(slot.chunk);
+
+  chunk_mesh_destroy(slot.mesh);
+  chunk_mesh_destroy(slot.stale_mesh);
+  chunk_neighbours_destroy(slot.neighbours);
+
+  slot.compressed = false;
+  slot.chunk      = {};
+  slot.modified   = false;
+  slot.generating = false;
+  slot.patched    = false;
+  slot.state      = ChunkSlotState::EMPTY;
+}
+
+static Region& chunk_world_region(ChunkWorld& world, glm::ivec2 chunk_coord)
+{
+  const glm::ivec2 coord = region_coord(chunk_coord);
+
+  size_t i = 0;
+  while(i != world.region_count && world.regions[i].coord != coord)
+    ++i;
+
+  if(i == world.region_count)
+  {
+    if(world.region_count == CHUNK_WORLD_REGION_CACHE_SIZE)
+      region_close(world.regions[--i]);
+    else
+      ++world.region_count;
+
+    region_open(world.regions[i], world.directory, coord);
+  }
+
+  std::rotate(&world.regions[0], &world.regions[i], &world.regions[i+1]);
+  return world.regions[0];
+}
+
+// Directions toward the horizontal neighbours, ordered like the faces
+static constexpr glm::ivec2 CHUNK_WORLD_SIDES[4] = { {-1, 0}, {1, 0}, {0, -1}, {0, 1} };
+
+// Chunk at coord if it can be looked at to mesh its neighbours, which is
+// only done at full detail since lower levels of detail keep their side
+// faces to hide cracks. Its blocks must also be there and stay readable
+// without decompressing them, which the mesher workers may already be
+// doing.
+static const Chunk *chunk_world_border_chunk(ChunkWorld& world, glm::ivec2 coord)
+{
+  const ChunkSlot& slot = chunk_world_slot(world, coord);
+  if(slot.state == ChunkSlotState::EMPTY || slot.coord != coord || slot.generating || slot.compressed || slot.lod != 0)
+    return nullptr;
+
+  return &slot.chunk;
+}
+
+// Bit d set if the neighbour in direction d of a chunk meshed at lod would
+// be meshed against, see chunk_neighbours_sides.
+static uint32_t chunk_world_neighbour_sides(ChunkWorld& world, glm::ivec2 coord, size_t lod)
+{
+  uint32_t sides = 0;
+  if(lod == 0)
+    for(size_t direction=0; direction<4; ++direction)
+      if(chunk_world_border_chunk(world, coord + CHUNK_WORLD_SIDES[direction]))
+        sides |= 1u << direction;
+  return sides;
+}
+
+// Replace the borders of the slot with those of its current neighbours
+static void chunk_world_update_neighbours(ChunkWorld& world, ChunkSlot& slot)
+{
+  chunk_neighbours_destroy(slot.neighbours);
+  if(slot.lod != 0)
+    return;
+
+  for(size_t direction=0; direction<4; ++direction)
+    if(const Chunk *neighbour = chunk_world_border_chunk(world, slot.coord + CHUNK_WORLD_SIDES[direction]))
+      slot.neighbours.borders[direction] = chunk_border_create(*neighbour, direction);
+}
+
+// Load the chunk into the slot and submit it for meshing. The terrain is
+// deterministic so only edited chunks are ever saved, and everything else is
+// generated again by the mesher workers.
+static void chunk_world_load(ChunkWorld& world, ChunkSlot& slot, glm::ivec2 coord)
+{
+  slot.coord = coord;
+  slot.lod   = chunk_world_lod(world, coord);
+  slot.state = ChunkSlotState::MESHING;
+  chunk_world_update_neighbours(world, slot);
+
+  Region& region = chunk_world_region(world, coord);
+  if(region_read_chunk(region, coord, slot.chunk))
+  {
+    slot.chunk.dirty_sections = 0;
+    slot.mesh_key = chunk_mesh_cache_key(slot.chunk, slot.neighbours, ChunkMeshMode::GREEDY, slot.lod);
+    if(chunk_mesh_cache_find(world.mesh_cache, slot.mesh_key, slot.mesh))
+      slot.state = ChunkSlotState::READY;
+    else
+      chunk_mesher_submit(world.mesher, slot.chunk, slot.neighbours, ChunkMeshMode::GREEDY, slot.lod, &slot);
+  }
+  else
+  {
+    slot.generating = true;
+    chunk_mesher_submit_generate(world.mesher, slot.chunk, slot.neighbours, world.seed, coord, ChunkMeshMode::GREEDY, slot.lod, &slot);
+  }
+}
+
+// Save the chunk if it has been edited and clear the slot.
+static void chunk_world_unload(ChunkWorld& world, ChunkSlot& slot)
+{
+  if(slot.state != ChunkSlotState::EMPTY && slot.modified)
+  {
+    Region& region = chunk_world_region(world, slot.coord);
+    if(slot.compressed)
+    {
+      region_write_chunk(region, slot.coord, slot.compressed_chunk);
+    }
+    else
+    {
+      CompressedChunk compressed_chunk = chunk_compress(slot.chunk);
+      region_write_chunk(region, slot.coord, compressed_chunk);
+      compressed_chunk_destroy(compressed_chunk);
+    }
+  }
+  chunk_slot_clear(slot);
+}
+
+void chunk_world_init(ChunkWorld& world, vulkan::context_t context, vulkan::allocator_t allocator, uint32_t seed, const char *directory)
+{
+  vulkan::get(context);
+  world.context = context;
+  vulkan::get(allocator);
+  world.allocator = allocator;
+
+  world.upload_command_buffer = vulkan::command_buffer_create(world.context);
+  world.uploading             = false;
+
+  world.seed         = seed;
+  world.directory    = directory;
+  world.region_count = 0;
+
+  chunk_mesher_init(world.mesher);
+  chunk_mesh_cache_init(world.mesh_cache, CHUNK_WORLD_MESH_CACHE_BUDGET);
+  world.center = glm::ivec2(0, 0);
+  for(ChunkSlot& slot : world.slots)
+    slot = ChunkSlot{ .state = ChunkSlotState::EMPTY, .coord = {}, .compressed = false, .chunk = {}, .compressed_chunk = {}, .modified = false, .generating = false, .patched = false, .neighbours = {}, .mesh = {}, .stale_mesh = {}, .lod = 0, .mesh_key = 0 };
+
+  world.draw_queue = create_dynarray<ChunkWorldSectionNode>(CHUNK_WORLD_WIDTH * CHUNK_WORLD_WIDTH * CHUNK_WORLD_SECTION_COUNT);
+}
+
+void chunk_world_deinit(ChunkWorld& world)
+{
+  if(world.uploading)
+    vulkan::command_buffer_wait(world.upload_command_buffer);
+
+  // Drop all outstanding jobs first so that no worker still reference a chunk
+  chunk_mesher_deinit(world.mesher);
+  for(ChunkSlot& slot : world.slots)
+    chunk_world_unload(world, slot);
+
+  chunk_mesh_cache_deinit(world.mesh_cache);
+
+  for(size_t i=0; i<world.region_count; ++i)
+    region_close(world.regions[i]);
+
+  destroy_dynarray(world.draw_queue);
+
+  vulkan::put(world.upload_command_buffer);
+  vulkan::put(world.allocator);
+  vulkan::put(world.context);
+}
+
+static void chunk_world_generate(ChunkWorld& world)
+{
+  // Walk outward one ring at a time so that the nearest chunks come first
+  size_t generated = 0;
+  for(int r=0; r<=CHUNK_WORLD_RADIUS; ++r)
+    for(int dy=-r; dy<=r; ++dy)
+      for(int dx=-r; dx<=r; ++dx)
+      {
+        if(std::max(std::abs(dx), std::abs(dy)) != r)
+          continue;
+
+        if(generated == CHUNK_WORLD_GENERATE_BUDGET)
+          return;
+
+        const glm::ivec2 coord = world.center + glm::ivec2(dx, dy);
+        ChunkSlot& slot = chunk_world_slot(world, coord);
+        if(slot.state != ChunkSlotState::EMPTY && slot.coord == coord)
+          continue;
+
+        // The previous chunk in this slot is still in use, try again next update
+        if(slot.state == ChunkSlotState::MESHING || slot.state == ChunkSlotState::UPLOADING)
+          continue;
+
+        chunk_world_unload(world, slot);
+        chunk_world_load(world, slot, coord);
+        ++generated;
+      }
+}
+
+static void chunk_world_begin_upload(ChunkWorld& world)
+{
+  if(!world.uploading)
+  {
+    vulkan::command_buffer_begin(world.upload_command_buffer);
+    world.uploading = true;
+  }
+}
+
+static void chunk_world_upload(ChunkWorld& world)
+{
+  size_t uploaded = 0;
+
+  ChunkMeshResult result;
+  while(uploaded != CHUNK_WORLD_UPLOAD_BUDGET && chunk_mesher_poll(world.mesher, result))
+  {
+    ChunkSlot& slot = *static_cast<ChunkSlot *>(result.data);
+    slot.generating = false;
+    if(!chunk_world_in_range(world, slot.coord))
+    {
+      chunk_world_unload(world, slot);
+      chunk_mesh_data_destroy(result.mesh_data);
+      continue;
+    }
+
+    // The chunk may only be known once generated, so the cache can only be
+    // checked now. The meshing work is lost but the upload is not.
+    slot.mesh_key = chunk_mesh_cache_key(slot.chunk, slot.neighbours, ChunkMeshMode::GREEDY, slot.lod);
+    if(size(result.mesh_data.sections) == 0 || chunk_mesh_cache_find(world.mesh_cache, slot.mesh_key, slot.mesh))
+    {
+      chunk_mesh_destroy(slot.stale_mesh);
+      slot.state = ChunkSlotState::READY;
+    }
+    else
+    {
+      chunk_world_begin_upload(world);
+      slot.mesh  = chunk_mesh_data_upload(world.upload_command_buffer, world.context, world.allocator, result.mesh_data);
+      slot.state = ChunkSlotState::UPLOADING;
+      ++uploaded;
+    }
+    chunk_mesh_data_destroy(result.mesh_data);
+  }
+}
+
+// Patch the sections of edited chunks in place, which is only done at full
+// detail and for meshes that are not shared. Chunks whose neighbours came or
+// went are patched whole. Chunks whose edited sections do not fit in their
+// ranges any more, other edited chunks and chunks whose level of detail
+// changed as the camera moved are meshed again from scratch instead, unless
+// the mesh cache already has a mesh for their new content. The old mesh is
+// drawn in the meantime.
+static void chunk_world_remesh(ChunkWorld& world)
+{
+  size_t lod_changes    = 0;
+  size_t border_changes = 0;
+  for(ChunkSlot& slot : world.slots)
+  {
+    if(slot.state != ChunkSlotState::READY || !chunk_world_in_range(world, slot.coord))
+      continue;
+
+    const size_t lod = chunk_world_lod(world, slot.coord);
+    if(lod != slot.lod)
+    {
+      if(lod_changes == CHUNK_WORLD_LOD_BUDGET)
+        continue;
+
+      chunk_world_get_chunk(world, slot.coord); // Decompress it if needed
+      ++lod_changes;
+    }
+    else
+    {
+      if(slot.compressed)
+        continue;
+
+      // Faces along the borders were culled against the neighbours there
+      // were at the time, so every section has to be meshed again once one
+      // comes or goes
+      if(chunk_world_neighbour_sides(world, slot.coord, lod) != chunk_neighbours_sides(slot.neighbours))
+      {
+        if(border_changes == CHUNK_WORLD_BORDER_BUDGET)
+          continue;
+
+        slot.chunk.dirty_sections = (uint64_t(1) << chunk_section_count(slot.chunk)) - 1;
+        ++border_changes;
+      }
+
+      if(slot.chunk.dirty_sections == 0)
+        continue;
+    }
+
+    const bool lod_changed = lod != slot.lod;
+    slot.lod = lod;
+    chunk_world_update_neighbours(world, slot);
+
+    const uint64_t mesh_key = chunk_mesh_cache_key(slot.chunk, slot.neighbours, ChunkMeshMode::GREEDY, lod);
+
+    ChunkMesh mesh;
+    if(chunk_mesh_cache_find(world.mesh_cache, mesh_key, mesh))
+    {
+      chunk_mesh_destroy(slot.mesh);
+      slot.mesh     = mesh;
+      slot.mesh_key = mesh_key;
+      slot.chunk.dirty_sections = 0;
+      continue;
+    }
+
+    if(!lod_changed && lod == 0)
+    {
+      // The cached mesh no longer match the chunk once patched
+      chunk_mesh_cache_remove(world.mesh_cache, slot.mesh_key, slot.mesh);
+      if(!chunk_mesh_is_shared(slot.mesh))
+      {
+        chunk_world_begin_upload(world);
+        if(chunk_mesh_update(world.upload_command_buffer, slot.mesh, slot.chunk, slot.neighbours, ChunkMeshMode::GREEDY))
+        {
+          slot.mesh_key = mesh_key;
+          slot.patched  = true;
+          continue;
+        }
+      }
+    }
+
+    slot.chunk.dirty_sections = 0;
+    slot.mesh_key = mesh_key;
+
+    slot.stale_mesh = slot.mesh;
+    slot.mesh       = {};
+    slot.state      = ChunkSlotState::MESHING;
+    chunk_mesher_submit(world.mesher, slot.chunk, slot.neighbours, ChunkMeshMode::GREEDY, lod, &slot);
+  }
+}
+
+static void chunk_world_compress(ChunkWorld& world)
+{
+  size_t compressed = 0;
+  for(ChunkSlot& slot : world.slots)
+  {
+    if(compressed == CHUNK_WORLD_COMPRESS_BUDGET)
+      return;
+
+    if(slot.state != ChunkSlotState::READY || slot.compressed)
+      continue;
+
+    const glm::ivec2 distance = glm::abs(slot.coord - world.center);
+    if(std::max(distance.x, distance.y) <= CHUNK_WORLD_COMPRESS_RADIUS)
+      continue;
+
+    slot.compressed_chunk = chunk_compress(slot.chunk);
+    slot.compressed       = true;
+    chunk_destroy(slot.chunk);
+    slot.chunk = {};
+    ++compressed;
+  }
+}
+
+Chunk *chunk_world_get_chunk(ChunkWorld& world, glm::ivec2 coord)
+{
+  ChunkSlot& slot = chunk_world_slot(world, coord);
+  if(slot.state != ChunkSlotState::READY || slot.coord != coord)
+    return nullptr;
+
+  if(slot.compressed)
+  {
+    slot.chunk      = chunk_decompress(slot.compressed_chunk);
+    slot.compressed = false;
+    compressed_chunk_destroy(slot.compressed_chunk);
+  }
+  return &slot.chunk;
+}
+
+static int floor_div(int a, int b)
+{
+  return a / b - (a % b < 0);
+}
+
+bool chunk_world_set_block(ChunkWorld& world, glm::ivec3 position, BlockType type)
+{
+  const glm::ivec2 coord = glm::ivec2(floor_div(position.x, CHUNK_SIZE), floor_div(position.y, CHUNK_SIZE));
+
+  Chunk *chunk = chunk_world_get_chunk(world, coord);
+  if(!chunk || position.z < 0 || (size_t)position.z >= chunk->height)
+    return false;
+
+  const size_t x = position.x - coord.x * (int)CHUNK_SIZE;
+  const size_t y = position.y - coord.y * (int)CHUNK_SIZE;
+
+  const BlockType previous = chunk_get_block(*chunk, x, y, position.z);
+  chunk_set_block(*chunk, x, y, position.z, type);
+  chunk_world_slot(world, coord).modified = true;
+
+  // Light spreads into the neighbouring chunks that can be modified right
+  // now, without decompressing them
+  ChunkLightNeighbourhood neighbourhood = {};
+  for(int dy=-1; dy<=1; ++dy)
+    for(int dx=-1; dx<=1; ++dx)
+    {
+      const glm::ivec2 neighbour_coord = coord + glm::ivec2(dx, dy);
+      ChunkSlot& slot = chunk_world_slot(world, neighbour_coord);
+      if(slot.state == ChunkSlotState::READY && slot.coord == neighbour_coord && !slot.compressed)
+        neighbourhood.chunks[(dx + 1) + (dy + 1) * 3] = &slot.chunk;
+    }
+  chunk_light_update(neighbourhood, x, y, position.z, previous);
+
+  // Neighbours whose light changed need saving as much as the chunk itself
+  for(int dy=-1; dy<=1; ++dy)
+    for(int dx=-1; dx<=1; ++dx)
+      if(neighbourhood.changed & 1 << ((dx + 1) + (dy + 1) * 3))
+        chunk_world_slot(world, coord + glm::ivec2(dx, dy)).modified = true;
+
+  // Faces of the neighbours along the border are culled against the block
+  auto mark_neighbour = [&](int dx, int dy) {
+    Chunk *neighbour = neighbourhood.chunks[(dx + 1) + (dy + 1) * 3];
+    if(neighbour && (size_t)position.z < neighbour->height)
+      chunk_mark_dirty(*neighbour, position.z);
+  };
+  if(x == 0)              mark_neighbour(-1, 0);
+  if(x == CHUNK_SIZE - 1) mark_neighbour( 1, 0);
+  if(y == 0)              mark_neighbour(0, -1);
+  if(y == CHUNK_SIZE - 1) mark_neighbour(0,  1);
+  return true;
+}
+
+// Slot holding the chunk at coord, compressed or not, or nullptr if it is not
+// loaded or is being meshed. Unlike chunk_world_get_chunk, this never
+// decompresses anything, so that chunks are only read in place.
+static const ChunkSlot *chunk_world_find_slot(const ChunkWorld& world, glm::ivec2 coord)
+{
+  const ChunkSlot& slot = chunk_world_slot(world, coord);
+  if(slot.state != ChunkSlotState::READY || slot.coord != coord)
+    return nullptr;
+
+  return &slot;
+}
+
+static size_t chunk_world_slot_height(const ChunkSlot& slot)
+{
+  return slot.compressed ? slot.compressed_chunk.height : slot.chunk.height;
+}
+
+// True if every layer of the section containing z is air, or if z is outside
+// of the chunk altogether.
+static bool chunk_world_section_empty(const ChunkSlot *slot, int z)
+{
+  if(!slot || z < 0 || (size_t)z >= chunk_world_slot_height(*slot))
+    return true;
+
+  if(slot->compressed)
+    return compressed_chunk_section_empty(slot->compressed_chunk, (size_t)z / CHUNK_SECTION_HEIGHT);
+
+  const size_t begin = (size_t)z / CHUNK_SECTION_HEIGHT * CHUNK_SECTION_HEIGHT;
+  const size_t end   = std::min(begin + CHUNK_SECTION_HEIGHT, slot->chunk.height);
+
+  uint64_t occupancy = 0;
+  for(size_t layer=begin; layer<end; ++layer)
+    occupancy |= slot->chunk.occupancy[layer];
+  return occupancy == 0;
+}
+
+static BlockType chunk_world_slot_get_block(const ChunkSlot& slot, size_t x, size_t y, size_t z)
+{
+  if(slot.compressed)
+    return compressed_chunk_get_block(slot.compressed_chunk, x, y, z);
+
+  return chunk_get_block(slot.chunk, x, y, z);
+}
+
+bool chunk_world_raycast(const ChunkWorld& world, glm::vec3 origin, glm::vec3 direction, float max_distance, ChunkRaycastHit& hit)
+{
+  // Everything below is in blocks, with t the distance along the ray
+  const glm::vec3 o     = origin / BLOCK_WIDTH;
+  const glm::vec3 d     = glm::normalize(direction);
+  const float     t_end = max_distance / BLOCK_WIDTH;
+
+  const glm::ivec3 step = glm::ivec3(glm::sign(d));
+  glm::vec3 t_delta;
+  for(int axis=0; axis<3; ++axis)
+    t_delta[axis] = step[axis] != 0 ? 1.0f / std::abs(d[axis]) : INFINITY;
+
+  glm::ivec3 cell = glm::ivec3(glm::floor(o));
+  int        axis = (int)(glm::abs(d).x >= glm::abs(d).y ? (glm::abs(d).x >= glm::abs(d).z ? 0 : 2) : (glm::abs(d).y >= glm::abs(d).z ? 1 : 2));
+  float      t    = 0.0f;
+
+  // Distance to the next boundary crossed along each axis, recomputed from
+  // scratch whenever the ray jump over an empty section
+  glm::vec3 t_max;
+  auto reset_t_max = [&]() {
+    for(int a=0; a<3; ++a)
+      t_max[a] = step[a] != 0 ? ((float)(cell[a] + (step[a] > 0)) - o[a]) / d[a] : INFINITY;
+  };
+  reset_t_max();
+
+  glm::ivec2       chunk_coord = glm::ivec2(floor_div(cell.x, CHUNK_SIZE), floor_div(cell.y, CHUNK_SIZE));
+  const ChunkSlot *slot        = chunk_world_find_slot(world, chunk_coord);
+
+  while(t <= t_end)
+  {
+    // Nothing but air below the world or above the tallest possible chunk
+    if((cell.z < 0 && step.z <= 0) || (cell.z >= (int)CHUNK_MAX_HEIGHT && step.z >= 0))
+      return false;
+
+    const glm::ivec2 coord = glm::ivec2(floor_div(cell.x, CHUNK_SIZE), floor_div(cell.y, CHUNK_SIZE));
+    if(coord != chunk_coord)
+    {
+      chunk_coord = coord;
+      slot        = chunk_world_find_slot(world, chunk_coord);
+    }
+
+    if(chunk_world_section_empty(slot, cell.z))
+    {
+      // Jump straight to the cell through which the ray leave the section
+      const glm::ivec3 box_min = glm::ivec3(
+        chunk_coord.x * (int)CHUNK_SIZE,
+        chunk_coord.y * (int)CHUNK_SIZE,
+        floor_div(cell.z, CHUNK_SECTION_HEIGHT) * (int)CHUNK_SECTION_HEIGHT
+      );
+      const glm::ivec3 box_max = box_min + glm::ivec3(CHUNK_SIZE, CHUNK_SIZE, CHUNK_SECTION_HEIGHT);
+
+      float t_exit = INFINITY;
+      for(int a=0; a<3; ++a)
+        if(step[a] != 0)
+        {
+          const float t_a = ((float)(step[a] > 0 ? box_max[a] : box_min[a]) - o[a]) / d[a];
+          if(t_a < t_exit)
+          {
+            t_exit = t_a;
+            axis   = a;
+          }
+        }
+
+      t = std::max(t, t_exit);
+      for(int a=0; a<3; ++a)
+        cell[a] = std::clamp((int)floorf(o[a] + d[a] * t), box_min[a], box_max[a] - 1);
+      cell[axis] = step[axis] > 0 ? box_max[axis] : box_min[axis] - 1;
+      reset_t_max();
+      continue;
+    }
+
+    const size_t    x    = cell.x - chunk_coord.x * (int)CHUNK_SIZE;
+    const size_t    y    = cell.y - chunk_coord.y * (int)CHUNK_SIZE;
+    const BlockType type = chunk_world_slot_get_block(*slot, x, y, cell.z);
+    if(type != BlockType::AIR)
+    {
+      hit.position  = cell;
+      hit.direction = (size_t)axis * 2 + (step[axis] < 0);
+      hit.distance  = t * BLOCK_WIDTH;
+      hit.type      = type;
+      return true;
+    }
+
+    axis = t_max.x < t_max.y ? (t_max.x < t_max.z ? 0 : 2) : (t_max.y < t_max.z ? 1 : 2);
+    t = t_max[axis];
+    cell[axis]  += step[axis];
+    t_max[axis] += t_delta[axis];
+  }
+  return false;
+}
+
+// Last chunk looked up, since consecutive cells are most often in the same
+// chunk
+struct ChunkWorldCursor
+{
+  bool             valid;
+  glm::ivec2       coord;
+  const ChunkSlot *slot;
+};
+
+static bool chunk_world_cell_solid(const ChunkWorld& world, ChunkWorldCursor& cursor, glm::ivec3 cell)
+{
+  if(cell.z < 0 || cell.z >= (int)CHUNK_MAX_HEIGHT)
+    return false;
+
+  const glm::ivec2 coord = glm::ivec2(floor_div(cell.x, CHUNK_SIZE), floor_div(cell.y, CHUNK_SIZE));
+  if(!cursor.valid || coord != cursor.coord)
+  {
+    cursor.valid = true;
+    cursor.coord = coord;
+    cursor.slot  = chunk_world_find_slot(world, coord);
+  }
+
+  if(!cursor.slot || (size_t)cell.z >= chunk_world_slot_height(*cursor.slot))
+    return false;
+
+  const size_t x = cell.x - coord.x * (int)CHUNK_SIZE;
+  const size_t y = cell.y - coord.y * (int)CHUNK_SIZE;
+  if(!cursor.slot->compressed)
+    return chunk_is_solid(cursor.slot->chunk, x, y, cell.z);
+
+  return compressed_chunk_get_block(cursor.slot->compressed_chunk, x, y, cell.z) != BlockType::AIR;
+}
+
+glm::vec3 chunk_world_sweep_box(const ChunkWorld& world, glm::vec3 min, glm::vec3 max, glm::vec3 displacement)
+{
+  // Everything below is in blocks
+  glm::vec3 lo = min / BLOCK_WIDTH;
+  glm::vec3 hi = max / BLOCK_WIDTH;
+  glm::vec3 d  = displacement / BLOCK_WIDTH;
+
+  ChunkWorldCursor cursor = {};
+  for(int axis=0; axis<3; ++axis)
+  {
+    if(d[axis] == 0.0f)
+      continue;
+
+    const int u = (axis + 1) % 3;
+    const int v = (axis + 2) % 3;
+
+    // Cells overlapped by the box across the direction of movement
+    const int u_begin = (int)floorf(lo[u]);
+    const int u_end   = (int)ceilf(hi[u]);
+    const int v_begin = (int)floorf(lo[v]);
+    const int v_end   = (int)ceilf(hi[v]);
+
+    // Layers of cells swept by the leading face of the box, nearest first,
+    // skipping the ones it already overlaps so that a box stuck inside of a
+    // block can still move out of it
+    const bool positive = d[axis] > 0.0f;
+    const int  step     = positive ? 1 : -1;
+    const int  first    = positive ? (int)ceilf(hi[axis])            : (int)floorf(lo[axis]) - 1;
+    const int  last     = positive ? (int)ceilf(hi[axis] + d[axis]) - 1 : (int)floorf(lo[axis] + d[axis]);
+
+    for(int layer=first; (layer - last) * step <= 0; layer += step)
+    {
+      bool blocked = false;
+      glm::ivec3 cell;
+      cell[axis] = layer;
+      for(cell[v]=v_begin; cell[v]<v_end && !blocked; ++cell[v])
+        for(cell[u]=u_begin; cell[u]<u_end && !blocked; ++cell[u])
+          blocked = chunk_world_cell_solid(world, cursor, cell);
+
+      if(blocked)
+      {
+        d[axis] = positive
+          ? std::max((float)layer - hi[axis] - CHUNK_WORLD_SWEEP_GAP, 0.0f)
+          : std::min((float)(layer + 1) - lo[axis] + CHUNK_WORLD_SWEEP_GAP, 0.0f);
+        break;
+      }
+    }
+
+    lo[axis] += d[axis];
+    hi[axis] += d[axis];
+  }
+  return d * BLOCK_WIDTH;
+}
+
+void chunk_world_update(ChunkWorld& world, glm::vec3 camera_position)
+{
+  world.center = chunk_world_coord(camera_position);
+
+  // Uploads submitted during the previous update have most likely finished
+  // by now, after which their meshes are safe to draw.
+  if(world.uploading)
+  {
+    vulkan::command_buffer_wait(world.upload_command_buffer);
+    vulkan::command_buffer_reset(world.upload_command_buffer);
+    world.uploading = false;
+
+    // Only cache meshes once uploaded so that a hit is always ready to draw
+    for(ChunkSlot& slot : world.slots)
+      if(slot.state == ChunkSlotState::UPLOADING)
+      {
+        chunk_mesh_destroy(slot.stale_mesh);
+        chunk_mesh_cache_insert(world.mesh_cache, slot.mesh_key, slot.mesh);
+        slot.state = ChunkSlotState::READY;
+      }
+      else if(slot.patched)
+      {
+        chunk_mesh_cache_insert(world.mesh_cache, slot.mesh_key, slot.mesh);
+        slot.patched = false;
+      }
+  }
+
+  chunk_world_generate(world);
+  chunk_world_upload(world);
+  chunk_world_remesh(world);
+  chunk_world_compress(world);
+
+  if(world.uploading)
+  {
+    vulkan::command_buffer_end(world.upload_command_buffer);
+    vulkan::command_buffer_submit(world.upload_command_buffer);
+  }
+}
+
+// Ordered like the faces, with the section along z
+static constexpr glm::ivec3 CHUNK_WORLD_SECTION_OFFSETS[6] = {
+  {-1, 0, 0}, {1, 0, 0},
+  {0, -1, 0}, {0, 1, 0},
+  {0, 0, -1}, {0, 0, 1},
+};
+static constexpr uint8_t CHUNK_WORLD_CAMERA_ENTRY = 6;
+
+static uint64_t chunk_world_section_visibility(ChunkWorld& world, glm::ivec2 coord, int section)
+{
+  const ChunkSlot& slot = chunk_world_slot(world, coord);
+  if(slot.state != ChunkSlotState::READY || slot.coord != coord || slot.lod != 0 || (size_t)section >= size(slot.mesh.sections))
+    return ~uint64_t(0);
+
+  return slot.mesh.sections[section].visibility;
+}
+
+// Sections of the chunk at origin that may have faces pointing toward the
+// camera in direction, going by the bounds of the chunk along x and y and of
+// each section along z.
+static uint64_t chunk_world_facing_sections(glm::vec3 origin, glm::vec3 camera_position, size_t direction)
+{
+  const float section_height = CHUNK_SECTION_HEIGHT * BLOCK_WIDTH;
+  const auto sections_below = [](float section) {
+    const int count = std::clamp((int)section, 0, (int)CHUNK_WORLD_SECTION_COUNT);
+    return count >= 64 ? ~uint64_t(0) : (uint64_t(1) << count) - 1;
+  };
+
+  switch(direction)
+  {
+  case 0: return camera_position.x < origin.x + CHUNK_WORLD_CHUNK_WIDTH ? ~uint64_t(0) : 0;
+  case 1: return camera_position.x > origin.x                           ? ~uint64_t(0) : 0;
+  case 2: return camera_position.y < origin.y + CHUNK_WORLD_CHUNK_WIDTH ? ~uint64_t(0) : 0;
+  case 3: return camera_position.y > origin.y                           ? ~uint64_t(0) : 0;
+  case 4: return ~sections_below(floorf(camera_position.z / section_height));
+  case 5: return sections_below(ceilf(camera_position.z / section_height));
+  }
+  return 0;
+}
+
+void chunk_world_draw(ChunkWorld& world, vulkan::renderer_t renderer, vulkan::material_t material, glm::vec3 camera_position)
+{
+  uint64_t visible[CHUNK_WORLD_WIDTH * CHUNK_WORLD_WIDTH] = {}; // Sections reached per slot
+
+  const glm::ivec2 camera_coord   = chunk_world_coord(camera_position);
+  const int        camera_section = std::clamp((int)floorf(camera_position.z / (CHUNK_SECTION_HEIGHT * BLOCK_WIDTH)), 0, (int)CHUNK_WORLD_SECTION_COUNT - 1);
+
+  size_t count = 0;
+  if(chunk_world_in_range(world, camera_coord))
+  {
+    world.draw_queue[count++] = ChunkWorldSectionNode{ camera_coord, camera_section, CHUNK_WORLD_CAMERA_ENTRY, 0 };
+    visible[&chunk_world_slot(world, camera_coord) - world.slots] |= uint64_t(1) << camera_section;
+  }
+
+  for(size_t head=0; head<count; ++head)
+  {
+    const ChunkWorldSectionNode node = world.draw_queue[head];
+    const uint64_t visibility = chunk_world_section_visibility(world, node.coord, node.section);
+    for(size_t direction=0; direction<6; ++direction)
+    {
+      // Never turn back toward the camera
+      const size_t opposite = direction ^ 1;
+      if(node.directions & (1u << opposite))
+        continue;
+
+      if(node.entry != CHUNK_WORLD_CAMERA_ENTRY && !chunk_section_visible(visibility, node.entry, direction))
+        continue;
+
+      const glm::ivec3 offset  = CHUNK_WORLD_SECTION_OFFSETS[direction];
+      const glm::ivec2 coord   = node.coord + glm::ivec2(offset.x, offset.y);
+      const int        section = node.section + offset.z;
+      if(!chunk_world_in_range(world, coord) || section < 0 || section >= (int)CHUNK_WORLD_SECTION_COUNT)
+        continue;
+
+      uint64_t& reached = visible[&chunk_world_slot(world, coord) - world.slots];
+      if(reached & (uint64_t(1) << section))
+        continue;
+
+      reached |= uint64_t(1) << section;
+      world.draw_queue[count++] = ChunkWorldSectionNode{ coord, section, (uint8_t)opposite, (uint8_t)(node.directions | 1u << direction) };
+    }
+  }
+
+  for(size_t i=0; i<CHUNK_WORLD_WIDTH * CHUNK_WORLD_WIDTH; ++i)
+  {
+    const ChunkSlot& slot = world.slots[i];
+    if(!chunk_world_in_range(world, slot.coord) || slot.state == ChunkSlotState::EMPTY)
+      continue;
+
+    const ChunkMesh& chunk_mesh = slot.state == ChunkSlotState::READY ? slot.mesh : slot.stale_mesh;
+    if(!chunk_mesh.mesh)
+      continue;
+
+    const glm::vec3 origin = chunk_world_origin(slot.coord);
+    const glm::mat4 model  = glm::translate(glm::mat4(1.0f), origin);
+
+    for(size_t direction=0; direction<6; ++direction)
+    {
+      // Sections above the chunk have nothing to draw
+      const uint64_t sections      = visible[i] & chunk_world_facing_sections(origin, camera_position, direction);
+      const size_t   section_count = size(chunk_mesh.sections);
+
+      size_t section = 0;
+      while(section < section_count)
+      {
+        if(!(sections >> section & 1))
+        {
+          ++section;
+          continue;
+        }
+
+        const size_t first = section;
+        while(section < section_count && sections >> section & 1)
+          ++section;
+
+        const ChunkMeshSection& last = chunk_mesh.sections[section - 1];
+        const size_t first_index = chunk_mesh.sections[first].first_index[direction];
+        vulkan::renderer_draw(renderer, material, chunk_mesh.mesh, model, first_index, last.first_index[direction] + last.index_count[direction] - first_index);
+      }
+    }
+  }
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include "chunk.hpp"
+#include "chunk_compression.hpp"
+#include "chunk_light.hpp"
+#include "chunk_mesh_cache.hpp"
+#include "chunk_mesher.hpp"
+#include "region.hpp"
+#include "core/command_buffer.hpp"
+#include "render/renderer.hpp"
+
+#include <glm/glm.hpp>
+
+// Number of chunks kept loaded in each direction around the chunk containing
+// the camera.
+static constexpr int    CHUNK_WORLD_RADIUS = 4;
+static constexpr size_t CHUNK_WORLD_WIDTH  = 2 * CHUNK_WORLD_RADIUS + 1;
+
+// Work done per call to chunk_world_update, so that moving into a new row of
+// chunks is spread over several frames instead of causing a hitch.
+static constexpr size_t CHUNK_WORLD_GENERATE_BUDGET = 8;
+static constexpr size_t CHUNK_WORLD_UPLOAD_BUDGET   = 4;
+static constexpr size_t CHUNK_WORLD_COMPRESS_BUDGET = 4;
+static constexpr size_t CHUNK_WORLD_LOD_BUDGET      = 4;
+static constexpr size_t CHUNK_WORLD_BORDER_BUDGET   = 4;
+
+// Chunks further than this from the camera are kept compressed once meshed.
+static constexpr int CHUNK_WORLD_COMPRESS_RADIUS = 2;
+
+// Chunks up to this far from the camera are meshed at full detail, and the
+// level of detail then drops by one for every chunk further away, so that
+// the last level is reached exactly at the edge of the loaded area.
+static constexpr int CHUNK_WORLD_LOD_RADIUS = CHUNK_WORLD_RADIUS - (int)(CHUNK_LOD_COUNT - 1);
+static_assert(CHUNK_WORLD_LOD_RADIUS >= 1);
+
+// GPU memory kept by the mesh cache for meshes that may be needed again, on
+// top of the meshes that are drawn.
+static constexpr size_t CHUNK_WORLD_MESH_CACHE_BUDGET = 64 << 20;
+
+// Number of region files kept open at once. The loaded area never span more
+// than a 2x2 block of regions, so this is enough to avoid reopening files
+// while the camera move around.
+static constexpr size_t CHUNK_WORLD_REGION_CACHE_SIZE = 4;
+
+enum class ChunkSlotState
+{
+  EMPTY,
+  MESHING,   // Chunk must not be touched until the mesher hand it back
+  UPLOADING, // Waiting for the upload command buffer
+  READY,     // Edits are patched into the mesh in place on the next update
+};
+
+struct ChunkSlot
+{
+  ChunkSlotState state;
+  glm::ivec2     coord;
+
+  // Only one of chunk and compressed_chunk is valid at a time
+  bool            compressed;
+  Chunk           chunk;
+  CompressedChunk compressed_chunk;
+
+  bool modified;   // Edited since it was loaded, and need to be saved on unload
+  bool generating; // Chunk is still being generated by the mesher
+  bool patched;    // Mesh patched in place, cached once the upload is done
+
+  // Borders of the neighbours the mesh was built against, only ever
+  // replaced when no job for the chunk is in flight
+  ChunkNeighbours neighbours;
+
+  ChunkMesh mesh;
+  ChunkMesh stale_mesh; // Drawn while the chunk is meshed again from scratch
+  size_t    lod;        // Level of detail of mesh, or of the one being generated
+  uint64_t  mesh_key;   // Key of mesh in the mesh cache
+};
+
+// Number of sections in a chunk as tall as it gets, and so in every column
+// of the world.
+static constexpr size_t CHUNK_WORLD_SECTION_COUNT = CHUNK_MAX_HEIGHT / CHUNK_SECTION_HEIGHT;
+static_assert(CHUNK_WORLD_SECTION_COUNT <= 64);
+
+// Section reached by the visibility search of chunk_world_draw
+struct ChunkWorldSectionNode
+{
+  glm::ivec2 coord;
+  int        section;
+  uint8_t    entry;      // Face it was entered through, or 6 for the section of the camera
+  uint8_t    directions; // Mask of the directions travelled from the camera to get there
+};
+
+// Chunks live in a fixed ring of slots indexed by their chunk coordinates
+// modulo CHUNK_WORLD_WIDTH. A slot is only reused once the camera has moved
+// far enough for its chunk to fall out of range, so memory usage stays
+// bounded no matter how far the camera travel.
+struct ChunkWorld
+{
+  vulkan::context_t        context;
+  vulkan::allocator_t      allocator;
+  vulkan::command_buffer_t upload_command_buffer;
+  bool                     uploading;
+
+  uint32_t seed;
+
+  // Most recently used region first
+  const char *directory;
+  Region      regions[CHUNK_WORLD_REGION_CACHE_SIZE];
+  size_t      region_count;
+
+  ChunkMesher    mesher;
+  ChunkMeshCache mesh_cache;
+  glm::ivec2     center;
+  ChunkSlot   slots[CHUNK_WORLD_WIDTH * CHUNK_WORLD_WIDTH];
+
+  // Big enough for every section in range to be reached once
+  dynarray<ChunkWorldSectionNode> draw_queue;
+};
+
+// Chunks are generated from the terrain for seed, unless they have been
+// edited in which case they are saved to and loaded from region files inside
+// directory instead.
+void chunk_world_init(ChunkWorld& world, vulkan::context_t context, vulkan::allocator_t allocator, uint32_t seed, const char *directory);
+void chunk_world_deinit(ChunkWorld& world);
+
+glm::ivec2 chunk_world_coord(glm::vec3 position);
+glm::vec3 chunk_world_origin(glm::ivec2 coord);
+
+// Return the chunk at coord, decompressing it if needed, or nullptr if it is
+// not loaded or currently being meshed.
+//
+// The chunk is only valid until the next chunk_world_update, which may
+// compress it again, hand it to the mesher or unload it, so the pointer must
+// not be kept around. Use chunk_world_raycast or chunk_world_sweep_box to
+// only read blocks, which leave compressed chunks alone.
+Chunk *chunk_world_get_chunk(ChunkWorld& world, glm::ivec2 coord);
+
+// Set the block at position, counted in blocks from the world origin. The
+// sections affected are remeshed and patched into the mesh of the chunk on
+// the next update. Return false if the chunk containing position is not
+// loaded or is being meshed, or if position is outside of it vertically.
+bool chunk_world_set_block(ChunkWorld& world, glm::ivec3 position, BlockType type);
+
+struct ChunkRaycastHit
+{
+  glm::ivec3 position;  // Of the block hit, counted in blocks as for chunk_world_set_block
+  size_t     direction; // Face the ray entered the block through, ordered like mesh faces
+  float      distance;  // Along the ray to the entry point
+  BlockType  type;
+};
+
+// Find the first block that is not air along the ray starting at origin,
+// with origin and max_distance in world units. Return false if there is none
+// within max_distance.
+//
+// Blocks are visited one by one with a 3D DDA, but whole sections that are
+// empty, as well as the space above a chunk and chunks that are not loaded,
+// are crossed in a single step. Compressed chunks are read in place without
+// being decompressed, so that nothing in the world is modified.
+bool chunk_world_raycast(const ChunkWorld& world, glm::vec3 origin, glm::vec3 direction, float max_distance, ChunkRaycastHit& hit);
+
+// Gap left between a box and the blocks it is stopped against, in blocks, so
+// that rounding never leave it overlapping them.
+static constexpr float CHUNK_WORLD_SWEEP_GAP = 1e-3f;
+
+// Move the axis aligned box [min, max] by displacement, in world units, and
+// return how far it can actually go before hitting a solid block. Movement is
+// resolved one axis at a time, x then y then z, so that a box hitting a wall
+// at an angle slides along it instead of stopping dead.
+//
+// Only the cells swept by the leading face of the box along each axis are
+// visited, nearest first, and nothing is allocated, so that many boxes can
+// be moved every update. Blocks the box already overlaps are ignored. As for
+// chunk_world_raycast, chunks that are not loaded or are being meshed are
+// treated as air, and compressed chunks are read in place.
+glm::vec3 chunk_world_sweep_box(const ChunkWorld& world, glm::vec3 min, glm::vec3 max, glm::vec3 displacement);
+
+void chunk_world_update(ChunkWorld& world, glm::vec3 camera_position);
+
+// Draw the sections that can be seen from the section containing the camera
+// through air. Sections are searched breadth first outward from the camera,
+// only ever moving away from it, and going from one section to the next
+// through a face only if that face can be seen through air from the face the
+// section was entered through, as recorded by ChunkMeshSection::visibility
+// when it was meshed. Chunks that are not loaded, meshed at a lower level of
+// detail, or waiting for a new mesh are assumed to be open all the way
+// through, as is the space above a chunk.
+//
+// Faces pointing away from the camera are skipped a whole direction at a
+// time, for a chunk along x and y and for a section along z, leaving less
+// for the rasterizer to cull. The faces of consecutive visible sections
+// pointing the same way are drawn together.
+void chunk_world_draw(ChunkWorld& world, vulkan::renderer_t renderer, vulkan::material_t material, glm::vec3 camera_position);
@@ -1,12 +1,15 @@
 #include "command_buffer.hpp"
 
+#include "utils.hpp"
 #include "vk_check.hpp"
 
 #include <assert.h>
 
 namespace vulkan
 {
-  static constexpr size_t MAX_RESOURCES_COUNT = 16;
+  // A frame reference 2 buffers per draw, so this is only the initial
+  // capacity and the list grow as needed.
+  static constexpr size_t INITIAL_RESOURCES_CAPACITY = 16;
 
   enum class CommandBufferState
   {
@@ -25,8 +28,7 @@ namespace vulkan
 
     CommandBufferState state;
 
-    size_t resource_count;
-    ref_t resources[MAX_RESOURCES_COUNT];
+    vector<ref_t> resources;
 
     VkCommandBuffer handle;
     VkFence         fence;
@@ -40,9 +42,9 @@ namespace vulkan
     VkDevice      device       = context_get_device_handle(command_buffer->context);
     VkCommandPool command_pool = context_get_default_command_pool(command_buffer->context);
 
-    for(size_t i=0; i<command_buffer->resource_count; ++i)
-      ref_put(command_buffer->resources[i]);
-    command_buffer->resource_count = 0;
+    for(ref_t resource : command_buffer->resources)
+      ref_put(resource);
+    destroy_vector(command_buffer->resources);
 
     vkFreeCommandBuffers(device, command_pool, 1, &command_buffer->handle);
     vkDestroyFence(device, command_buffer->fence, nullptr);
@@ -65,7 +67,7 @@ namespace vulkan
     VkCommandPool command_pool = context_get_default_command_pool(command_buffer->context);
 
     command_buffer->state          = initial_state_pending ? CommandBufferState::PENDING : CommandBufferState::INITIAL;
-    command_buffer->resource_count = 0;
+    command_buffer->resources      = create_vector<ref_t>(INITIAL_RESOURCES_CAPACITY);
 
     VkCommandBufferAllocateInfo command_buffer_allocate_info = {};
     command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -90,9 +92,8 @@ namespace vulkan
   void command_buffer_use(command_buffer_t command_buffer, ref_t resource)
   {
     assert(command_buffer->state == CommandBufferState::RECORDING);
-    assert(command_buffer->resource_count != MAX_RESOURCES_COUNT);
     ref_get(resource);
-    command_buffer->resources[command_buffer->resource_count++] = resource;
+    vector_resize_push(command_buffer->resources, resource);
   }
 
   void command_buffer_begin(command_buffer_t command_buffer)
@@ -156,9 +157,9 @@ namespace vulkan
   {
     assert(command_buffer->state != CommandBufferState::PENDING);
     vkResetCommandBuffer(command_buffer->handle, 0);
-    for(size_t i=0; i<command_buffer->resource_count; ++i)
-      ref_put(command_buffer->resources[i]);
-    command_buffer->resource_count = 0;
+    for(ref_t resource : command_buffer->resources)
+      ref_put(resource);
+    command_buffer->resources.size = 0;
     command_buffer->state = CommandBufferState::INITIAL;
   }
 }
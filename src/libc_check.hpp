@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <type_traits>
+
+template<typename T>
+static T *libc_check(const char* expr_str, T *ptr)
+{
+  if(!ptr)
+  {
+    perror(expr_str);
+    abort();
+  }
+  return ptr;
+}
+
+template<typename T>
+static T libc_check(const char* expr_str, T value) requires(std::is_integral_v<T> && std::is_signed_v<T>)
+{
+  if(value < 0)
+  {
+    perror(expr_str);
+    abort();
+  }
+  return value;
+}
+
+#define LIBC_CHECK(expr) libc_check(#expr, expr)
@@ -9,7 +9,7 @@
 #include "resources/mesh.hpp"
 #include "resources/sampler.hpp"
 
-#include "chunk.hpp"
+#include "chunk_world.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -40,6 +40,10 @@ static constexpr const unsigned WINDOW_HEIGHT = 720;
 static constexpr const char *VERTEX_SHADER_FILE_NAME   = "shaders/vert.spv";
 static constexpr const char *FRAGMENT_SHADER_FILE_NAME = "shaders/frag.spv";
 
+static constexpr const char *VOXEL_VERTEX_SHADER_FILE_NAME = "shaders/voxel_vert.spv";
+
+static constexpr uint32_t WORLD_SEED = 0x5eed;
+
 struct Application
 {
   vulkan::context_t       context;
@@ -47,12 +51,12 @@ struct Application
 
   vulkan::render_target_t render_target;
   vulkan::renderer_t      renderer;
+  vulkan::renderer_t      voxel_renderer;
 
   vulkan::mesh_t     mesh;
   vulkan::material_t material;
 
-  Chunk           chunk;
-  vulkan::mesh_t  chunk_mesh;
+  ChunkWorld world;
 
   vulkan::Camera camera;
 
@@ -78,9 +82,16 @@ void application_init(Application& application)
     application.render_target     = vulkan::render_target_create(application.context, application.allocator, swapchain);
     application.renderer          = vulkan::renderer_create(application.context, application.render_target, mesh_layout, material_layout, vertex_shader, fragment_shader);
 
+    // Chunks use their own packed vertex format
+    vulkan::mesh_layout_t voxel_mesh_layout   = voxel_mesh_layout_create();
+    vulkan::shader_t      voxel_vertex_shader = vulkan::shader_load(application.context, VOXEL_VERTEX_SHADER_FILE_NAME);
+    application.voxel_renderer = vulkan::renderer_create(application.context, application.render_target, voxel_mesh_layout, material_layout, voxel_vertex_shader, fragment_shader);
+
     vulkan::put(mesh_layout);
+    vulkan::put(voxel_mesh_layout);
     vulkan::put(material_layout);
     vulkan::put(vertex_shader);
+    vulkan::put(voxel_vertex_shader);
     vulkan::put(fragment_shader);
     vulkan::put(swapchain);
   }
@@ -91,19 +102,18 @@ void application_init(Application& application)
     application.mesh     = vulkan::mesh_load   (command_buffer, application.context, application.allocator, "resources/viking_room.obj");
     application.material = vulkan::material_load(command_buffer, application.context, application.allocator, "resources/viking_room.png");
 
-    application.chunk      = chunk_generate_random();
-    application.chunk_mesh = chunk_generate_mesh(command_buffer, application.context, application.allocator, application.chunk);
-
     command_buffer_end(command_buffer);
     command_buffer_submit(command_buffer);
     command_buffer_wait(command_buffer);
   }
   put(command_buffer);
 
+  chunk_world_init(application.world, application.context, application.allocator, WORLD_SEED, "world");
+
   unsigned width, height;
   vulkan::render_target_get_extent(application.render_target, width, height);
 
-  application.camera.transform.position = glm::vec3(2.0f, 2.0f, 0.5f);
+  application.camera.transform.position = glm::vec3(2.0f, 2.0f, 16.0f); // Above most of the terrain
   application.camera.transform.rotation = glm::angleAxis(0.0f, glm::vec3(0.0f, 1.0f, 0.0f));
 
   application.camera.yaw   = 0.0f;
@@ -121,22 +131,26 @@ void application_deinit(Application& application)
   VkDevice device = vulkan::context_get_device_handle(application.context);
   vkDeviceWaitIdle(device);
 
+  chunk_world_deinit(application.world);
+
   vulkan::put(application.context);
   vulkan::put(application.allocator);
 
   vulkan::put(application.render_target);
   vulkan::put(application.renderer);
+  vulkan::put(application.voxel_renderer);
 
   vulkan::put(application.mesh);
   vulkan::put(application.material);
-
-  chunk_destroy(application.chunk);
-  vulkan::put(application.chunk_mesh);
 }
 
 static constexpr float MOUSE_SENSITIVITY = 1 / 500.0f;
 static constexpr float MOVEMENT_SPEED    = 0.01f;
 
+// Half the size of the box kept out of the blocks around the camera, a bit
+// larger than the near plane so that blocks are never clipped
+static constexpr glm::vec3 CAMERA_HALF_EXTENT = glm::vec3(0.12f);
+
 void application_update(Application& application)
 {
   vulkan::context_handle_events(application.context);
@@ -167,7 +181,11 @@ void application_update(Application& application)
   if(glfwGetKey(window, GLFW_KEY_RIGHT_SHIFT) == GLFW_PRESS) direction += glm::vec3(0.0f, 0.0f, -1.0f);
   if(glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)       direction += glm::vec3(0.0f, 0.0f,  1.0f);
 
-  vulkan::camera_translate(application.camera, MOVEMENT_SPEED * direction);
+  const glm::vec3 position     = application.camera.transform.position;
+  const glm::vec3 displacement = vulkan::transform_local_to_world(application.camera.transform, MOVEMENT_SPEED * direction);
+  application.camera.transform.position += chunk_world_sweep_box(application.world, position - CAMERA_HALF_EXTENT, position + CAMERA_HALF_EXTENT, displacement);
+
+  chunk_world_update(application.world, application.camera.transform.position);
 }
 
 void application_render(Application& application)
@@ -180,9 +198,14 @@ void application_render(Application& application)
   vulkan::renderer_set_viewport_and_scissor(application.renderer, {width, height});
   vulkan::renderer_use_camera(application.renderer, application.camera);
   //vulkan::renderer_draw(application.renderer, application.material, application.mesh);
-  vulkan::renderer_draw(application.renderer, application.material, application.chunk_mesh);
-
   vulkan::renderer_end_render(application.renderer);
+
+  vulkan::renderer_begin_render(application.voxel_renderer, frame);
+  vulkan::renderer_set_viewport_and_scissor(application.voxel_renderer, {width, height});
+  vulkan::renderer_use_camera(application.voxel_renderer, application.camera);
+  chunk_world_draw(application.world, application.voxel_renderer, application.material, application.camera.transform.position);
+  vulkan::renderer_end_render(application.voxel_renderer);
+
   vulkan::render_target_end_frame(application.render_target, frame);
 }
 
@@ -0,0 +1,190 @@
+#include "region.hpp"
+
+#include "libc_check.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static constexpr size_t REGION_PAYLOAD_HEADER_SIZE = sizeof(uint16_t) + sizeof(uint8_t);
+static constexpr size_t REGION_RUNS_SIZE_SIZE      = sizeof(uint32_t);
+
+static int floor_div(int a, int b)
+{
+  return a / b - (a % b < 0);
+}
+
+glm::ivec2 region_coord(glm::ivec2 chunk_coord)
+{
+  return glm::ivec2(floor_div(chunk_coord.x, REGION_SIZE), floor_div(chunk_coord.y, REGION_SIZE));
+}
+
+static size_t region_entry_index(const Region& region, glm::ivec2 chunk_coord)
+{
+  const glm::ivec2 local = chunk_coord - region.coord * REGION_SIZE;
+  assert(local.x >= 0 && local.x < REGION_SIZE && local.y >= 0 && local.y < REGION_SIZE);
+  return local.y * REGION_SIZE + local.x;
+}
+
+static void region_write_all(const Region& region, const void *data, size_t size, size_t offset)
+{
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  while(size != 0)
+  {
+    const ssize_t written = LIBC_CHECK(pwrite(region.fd, bytes, size, offset));
+    bytes  += written;
+    size   -= written;
+    offset += written;
+  }
+}
+
+static void region_map(Region& region)
+{
+  if(region.mapping)
+    LIBC_CHECK(munmap(region.mapping, region.mapping_size));
+
+  void *mapping = mmap(nullptr, region.file_size, PROT_READ, MAP_SHARED, region.fd, 0);
+  if(mapping == MAP_FAILED)
+  {
+    perror("mmap");
+    abort();
+  }
+
+  region.mapping      = static_cast<uint8_t *>(mapping);
+  region.mapping_size = region.file_size;
+}
+
+void region_open(Region& region, const char *directory, glm::ivec2 coord)
+{
+  if(mkdir(directory, 0755) != 0 && errno != EEXIST)
+  {
+    perror(directory);
+    abort();
+  }
+
+  char path[256];
+  snprintf(path, sizeof path, "%s/r.%d.%d.bin", directory, coord.x, coord.y);
+
+  region = {};
+  region.coord = coord;
+  region.fd    = LIBC_CHECK(open(path, O_RDWR | O_CREAT, 0644));
+
+  struct stat st;
+  LIBC_CHECK(fstat(region.fd, &st));
+  region.file_size = st.st_size;
+  if(region.file_size == 0)
+  {
+    RegionHeader header = {};
+    header.magic   = REGION_MAGIC;
+    header.version = REGION_VERSION;
+    region_write_all(region, &header, sizeof header, 0);
+    region.file_size = sizeof header;
+  }
+
+  if(region.file_size < sizeof(RegionHeader))
+  {
+    fprintf(stderr, "Region file %s is truncated\n", path);
+    abort();
+  }
+
+  region_map(region);
+
+  const RegionHeader *header = reinterpret_cast<const RegionHeader *>(region.mapping);
+  if(header->magic != REGION_MAGIC || header->version != REGION_VERSION)
+  {
+    fprintf(stderr, "Region file %s has an unknown format\n", path);
+    abort();
+  }
+}
+
+void region_close(Region& region)
+{
+  LIBC_CHECK(munmap(region.mapping, region.mapping_size));
+  LIBC_CHECK(close(region.fd));
+  region = {};
+}
+
+bool region_read_chunk(Region& region, glm::ivec2 chunk_coord, Chunk& chunk)
+{
+  const RegionHeader *header = reinterpret_cast<const RegionHeader *>(region.mapping);
+  const RegionEntry   entry  = header->entries[region_entry_index(region, chunk_coord)];
+  if(entry.offset == 0)
+    return false;
+
+  // The payload was appended after the file was last mapped
+  const size_t end = (size_t)entry.offset + entry.size;
+  if(end > region.mapping_size && end <= region.file_size)
+    region_map(region);
+
+  if(entry.offset < sizeof(RegionHeader) || end > region.mapping_size || entry.size < REGION_PAYLOAD_HEADER_SIZE)
+  {
+    fprintf(stderr, "Region %d,%d: chunk %d,%d points outside of the file\n", region.coord.x, region.coord.y, chunk_coord.x, chunk_coord.y);
+    return false;
+  }
+
+  const uint8_t *payload = region.mapping + entry.offset;
+
+  uint16_t height;
+  memcpy(&height, payload, sizeof height);
+
+  const uint8_t palette_size = payload[sizeof height];
+  if(palette_size > (size_t)BlockType::COUNT || entry.size < REGION_PAYLOAD_HEADER_SIZE + palette_size)
+  {
+    fprintf(stderr, "Region %d,%d: chunk %d,%d has a corrupt palette\n", region.coord.x, region.coord.y, chunk_coord.x, chunk_coord.y);
+    return false;
+  }
+
+  const size_t runs_offset = REGION_PAYLOAD_HEADER_SIZE + palette_size + REGION_RUNS_SIZE_SIZE;
+  if(entry.size < runs_offset)
+  {
+    fprintf(stderr, "Region %d,%d: chunk %d,%d has a corrupt palette\n", region.coord.x, region.coord.y, chunk_coord.x, chunk_coord.y);
+    return false;
+  }
+
+  uint32_t runs_size;
+  memcpy(&runs_size, payload + runs_offset - REGION_RUNS_SIZE_SIZE, sizeof runs_size);
+  if(runs_size > entry.size - runs_offset)
+  {
+    fprintf(stderr, "Region %d,%d: chunk %d,%d has corrupt blocks\n", region.coord.x, region.coord.y, chunk_coord.x, chunk_coord.y);
+    return false;
+  }
+
+  const BlockType *palette         = reinterpret_cast<const BlockType *>(payload + REGION_PAYLOAD_HEADER_SIZE);
+  const uint8_t   *runs            = payload + runs_offset;
+  const uint8_t   *light_runs      = runs + runs_size;
+  const size_t     light_runs_size = entry.size - runs_offset - runs_size;
+  if(!chunk_decompress(height, palette, palette_size, runs, runs_size, light_runs, light_runs_size, chunk))
+  {
+    fprintf(stderr, "Region %d,%d: chunk %d,%d has corrupt blocks\n", region.coord.x, region.coord.y, chunk_coord.x, chunk_coord.y);
+    return false;
+  }
+  return true;
+}
+
+void region_write_chunk(Region& region, glm::ivec2 chunk_coord, const CompressedChunk& compressed_chunk)
+{
+  assert(compressed_chunk.height <= UINT16_MAX);
+
+  const uint16_t height    = compressed_chunk.height;
+  const uint32_t runs_size = size(compressed_chunk.runs);
+
+  RegionEntry entry = {};
+  entry.offset = region.file_size;
+  entry.size   = REGION_PAYLOAD_HEADER_SIZE + compressed_chunk.palette_size + REGION_RUNS_SIZE_SIZE + runs_size + size(compressed_chunk.light_runs);
+
+  size_t offset = entry.offset;
+  region_write_all(region, &height, sizeof height, offset);                                               offset += sizeof height;
+  region_write_all(region, &compressed_chunk.palette_size, sizeof(uint8_t), offset);                      offset += sizeof(uint8_t);
+  region_write_all(region, compressed_chunk.palette, compressed_chunk.palette_size, offset);               offset += compressed_chunk.palette_size;
+  region_write_all(region, &runs_size, sizeof runs_size, offset);                                         offset += sizeof runs_size;
+  region_write_all(region, data(compressed_chunk.runs), runs_size, offset);                               offset += runs_size;
+  region_write_all(region, data(compressed_chunk.light_runs), size(compressed_chunk.light_runs), offset); offset += size(compressed_chunk.light_runs);
+  region.file_size = offset;
+
+  // Only publish the chunk in the header once its payload is in place
+  const size_t entry_offset = offsetof(RegionHeader, entries) + region_entry_index(region, chunk_coord) * sizeof(RegionEntry);
+  region_write_all(region, &entry, sizeof entry, entry_offset);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "chunk.hpp"
+#include "chunk_compression.hpp"
+
+#include <glm/glm.hpp>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Chunks are persisted in region files each covering REGION_SIZE x
+// REGION_SIZE chunks. A region file start with a fixed header holding the
+// offset and size of the payload of every chunk in the region, followed by
+// the payloads themselves. A payload is a chunk compressed by chunk_compress:
+//
+//   uint16_t  height
+//   uint8_t   palette_size
+//   BlockType palette[palette_size]
+//   uint32_t  runs_size
+//   uint8_t   runs[runs_size]
+//   uint8_t   light_runs[]
+//
+// The file is read through mmap so that chunks are paged in only when they
+// are actually loaded and decompressed straight out of the mapping. Writes
+// always append a new payload and then update the header, so a chunk that is
+// saved repeatedly leaves dead payloads behind until the file is rewritten.
+static constexpr int      REGION_SIZE    = 32;
+static constexpr uint32_t REGION_MAGIC   = 0x47525856; // "VXRG"
+static constexpr uint32_t REGION_VERSION = 2;
+
+struct RegionEntry
+{
+  uint32_t offset; // 0 if the chunk is not present
+  uint32_t size;
+};
+
+struct RegionHeader
+{
+  uint32_t    magic;
+  uint32_t    version;
+  RegionEntry entries[REGION_SIZE * REGION_SIZE];
+};
+
+struct Region
+{
+  glm::ivec2 coord;
+  int        fd;
+
+  size_t   file_size;
+  uint8_t *mapping; // Cover the first mapping_size bytes of the file
+  size_t   mapping_size;
+};
+
+glm::ivec2 region_coord(glm::ivec2 chunk_coord);
+
+// Open the region file at coord inside directory, creating it if needed.
+void region_open(Region& region, const char *directory, glm::ivec2 coord);
+void region_close(Region& region);
+
+// Return false if the chunk has never been written to the region, or if its
+// entry or payload is corrupt, in which case it should be generated again.
+// Corruption is reported on stderr.
+bool region_read_chunk(Region& region, glm::ivec2 chunk_coord, Chunk& chunk);
+void region_write_chunk(Region& region, glm::ivec2 chunk_coord, const CompressedChunk& compressed_chunk);
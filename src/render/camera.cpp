@@ -18,9 +18,8 @@ namespace vulkan
     transform_translate_local(camera.transform, direction);
   }
 
-  CameraMatrices camera_compute_matrices(const Camera& camera)
+  CameraMatrices camera_compute_matrices(const Camera& camera, const glm::mat4& model)
   {
-    glm::mat4 model = glm::mat4(1.0f);
     glm::mat4 view  = glm::inverse(transform_as_mat4(camera.transform));
 
     glm::mat4 perspective = glm::perspective(camera.fov, camera.aspect_ratio, 0.1f, 10.0f);
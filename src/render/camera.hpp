@@ -25,5 +25,5 @@ namespace vulkan
   };
   static_assert(sizeof(CameraMatrices) == 128);
 
-  CameraMatrices camera_compute_matrices(const Camera& camera);
+  CameraMatrices camera_compute_matrices(const Camera& camera, const glm::mat4& model = glm::mat4(1.0f));
 }
@@ -24,6 +24,7 @@ namespace vulkan
     VkPipeline       pipeline;
 
     const Frame *current_frame;
+    Camera       current_camera;
   };
   REF_DEFINE(Renderer, renderer_t, ref);
 
@@ -266,11 +267,13 @@ namespace vulkan
   {
     VkCommandBuffer handle = command_buffer_get_handle(renderer->current_frame->command_buffer);
 
+    renderer->current_camera = camera;
+
     vulkan::CameraMatrices camera_matrices = vulkan::camera_compute_matrices(camera);
     vkCmdPushConstants(handle, renderer->pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof camera_matrices, &camera_matrices);
   }
 
-  void renderer_draw(renderer_t renderer, material_t material, mesh_t mesh)
+  static void renderer_draw_mesh(renderer_t renderer, material_t material, mesh_t mesh, size_t first_index, size_t index_count)
   {
     VkCommandBuffer handle = command_buffer_get_handle(renderer->current_frame->command_buffer);
 
@@ -294,8 +297,33 @@ namespace vulkan
     vkCmdBindIndexBuffer(handle, index_buffer_handle, 0, VK_INDEX_TYPE_UINT32);
     command_buffer_use(renderer->current_frame->command_buffer, as_ref(index_buffer));
 
-    // Index buffers
-    size_t index_count = mesh_get_index_count(mesh);
-    vkCmdDrawIndexed(handle, index_count, 1, 0, 0, 0);
+    vkCmdDrawIndexed(handle, index_count, 1, first_index, 0, 0);
+  }
+
+  void renderer_draw(renderer_t renderer, material_t material, mesh_t mesh, size_t first_index, size_t index_count)
+  {
+    renderer_draw(renderer, material, mesh, glm::mat4(1.0f), first_index, index_count);
+  }
+
+  void renderer_draw(renderer_t renderer, material_t material, mesh_t mesh)
+  {
+    renderer_draw(renderer, material, mesh, 0, mesh_get_index_count(mesh));
+  }
+
+  void renderer_draw(renderer_t renderer, material_t material, mesh_t mesh, const glm::mat4& model, size_t first_index, size_t index_count)
+  {
+    VkCommandBuffer handle = command_buffer_get_handle(renderer->current_frame->command_buffer);
+
+    // Positions may be quantized, in which case the mesh knows how to get
+    // them back into model space
+    vulkan::CameraMatrices camera_matrices = vulkan::camera_compute_matrices(renderer->current_camera, model * mesh_get_transform(mesh));
+    vkCmdPushConstants(handle, renderer->pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof camera_matrices, &camera_matrices);
+
+    renderer_draw_mesh(renderer, material, mesh, first_index, index_count);
+  }
+
+  void renderer_draw(renderer_t renderer, material_t material, mesh_t mesh, const glm::mat4& model)
+  {
+    renderer_draw(renderer, material, mesh, model, 0, mesh_get_index_count(mesh));
   }
 }
@@ -25,4 +25,13 @@ namespace vulkan
   void renderer_set_viewport_and_scissor(renderer_t renderer, VkExtent2D extent);
   void renderer_use_camera(renderer_t renderer, const Camera& camera);
   void renderer_draw(renderer_t renderer, material_t material, mesh_t mesh);
+
+  // Draw with a model matrix relative to the camera last passed to
+  // renderer_use_camera. Either way the transform of the mesh is applied
+  // first, see mesh_get_transform.
+  void renderer_draw(renderer_t renderer, material_t material, mesh_t mesh, const glm::mat4& model);
+
+  // Draw only index_count indices of the mesh starting at first_index.
+  void renderer_draw(renderer_t renderer, material_t material, mesh_t mesh, size_t first_index, size_t index_count);
+  void renderer_draw(renderer_t renderer, material_t material, mesh_t mesh, const glm::mat4& model, size_t first_index, size_t index_count);
 }
@@ -1,37 +1,13 @@
 #include "shader.hpp"
 
+#include "libc_check.hpp"
 #include "vk_check.hpp"
 #include "utils.hpp"
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <type_traits>
 
 
-template<typename T>
-static T *libc_check(const char* expr_str, T *ptr)
-{
-  if(!ptr)
-  {
-    perror(expr_str);
-    abort();
-  }
-  return ptr;
-}
-
-template<typename T>
-static T libc_check(const char* expr_str, T value) requires(std::is_integral_v<T> && std::is_signed_v<T>)
-{
-  if(value < 0)
-  {
-    perror(expr_str);
-    abort();
-  }
-  return value;
-}
-
-#define LIBC_CHECK(expr) libc_check(#expr, expr)
-
 static inline dynarray<char> read_file(const char *file_name)
 {
   FILE *file = LIBC_CHECK(fopen(file_name, "rb"));
@@ -3,6 +3,9 @@
 #include "allocator.hpp"
 #include "vk_check.hpp"
 
+#include <algorithm>
+#include <vector>
+
 #include <string.h>
 #include <assert.h>
 
@@ -32,6 +35,31 @@ namespace vulkan
     }
   }
 
+  // Stages and accesses through which the buffer is read outside of transfers
+  static VkPipelineStageFlags get_vulkan_buffer_stages(BufferType type)
+  {
+    switch(type)
+    {
+    case BufferType::STAGING_BUFFER: return VK_PIPELINE_STAGE_TRANSFER_BIT;
+    case BufferType::VERTEX_BUFFER:  return VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+    case BufferType::INDEX_BUFFER:   return VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+    case BufferType::UNIFORM_BUFFER: return VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    default: assert(false && "Unreachable");
+    }
+  }
+
+  static VkAccessFlags get_vulkan_buffer_access(BufferType type)
+  {
+    switch(type)
+    {
+    case BufferType::STAGING_BUFFER: return VK_ACCESS_TRANSFER_READ_BIT;
+    case BufferType::VERTEX_BUFFER:  return VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+    case BufferType::INDEX_BUFFER:   return VK_ACCESS_INDEX_READ_BIT;
+    case BufferType::UNIFORM_BUFFER: return VK_ACCESS_UNIFORM_READ_BIT;
+    default: assert(false && "Unreachable");
+    }
+  }
+
   struct Buffer
   {
     Ref ref;
@@ -39,6 +67,7 @@ namespace vulkan
     context_t   context;
     allocator_t allocator;
 
+    BufferType      type;
     VkBuffer        handle;
     device_memory_t device_memory;
   };
@@ -69,6 +98,8 @@ namespace vulkan
     get(allocator);
     buffer->allocator = allocator;
 
+    buffer->type = type;
+
     VkDevice device = context_get_device_handle(buffer->context);
 
     VkBufferCreateInfo buffer_create_info = {};
@@ -135,4 +166,102 @@ namespace vulkan
       put(staging_buffer);
     }
   }
+
+  void buffer_write(command_buffer_t command_buffer, buffer_t buffer, const void *data, size_t size, size_t offset)
+  {
+    const BufferWrite write = { buffer, data, size, offset };
+    buffer_write(command_buffer, &write, 1);
+  }
+
+  void buffer_write(command_buffer_t command_buffer, const BufferWrite *writes, size_t write_count)
+  {
+    // Always go through a copy, even if the buffers are mappable, since
+    // writing to the mapping directly would race with frames still reading it
+    size_t staging_size = 0;
+    for(size_t i=0; i<write_count; ++i)
+    {
+      assert(writes[i].buffer->type != BufferType::STAGING_BUFFER);
+      staging_size += writes[i].size;
+    }
+
+    if(staging_size == 0)
+      return;
+
+    buffer_t staging_buffer = buffer_create(writes[0].buffer->context, writes[0].buffer->allocator, BufferType::STAGING_BUFFER, staging_size);
+    {
+      uint8_t *staging_data = static_cast<uint8_t *>(device_memory_map(staging_buffer->device_memory));
+      for(size_t i=0, offset=0; i<write_count; offset += writes[i++].size)
+        memcpy(staging_data + offset, writes[i].data, writes[i].size);
+      device_memory_unmap(staging_buffer->device_memory);
+    }
+
+    VkCommandBuffer handle = command_buffer_get_handle(command_buffer);
+    command_buffer_use(command_buffer, as_ref(staging_buffer));
+
+    // One barrier and one copy per distinct buffer, covering every range
+    // written to it
+    std::vector<buffer_t>              buffers;
+    std::vector<VkBufferMemoryBarrier> barriers;
+    VkPipelineStageFlags               stages = 0;
+    for(size_t i=0; i<write_count; ++i)
+    {
+      if(writes[i].size == 0)
+        continue;
+
+      auto it = std::find(buffers.begin(), buffers.end(), writes[i].buffer);
+      if(it != buffers.end())
+      {
+        VkBufferMemoryBarrier& barrier = barriers[it - buffers.begin()];
+        const VkDeviceSize end = std::max<VkDeviceSize>(barrier.offset + barrier.size, writes[i].offset + writes[i].size);
+        barrier.offset = std::min<VkDeviceSize>(barrier.offset, writes[i].offset);
+        barrier.size   = end - barrier.offset;
+        continue;
+      }
+
+      buffer_t buffer = writes[i].buffer;
+      command_buffer_use(command_buffer, as_ref(buffer));
+      stages |= get_vulkan_buffer_stages(buffer->type);
+
+      VkBufferMemoryBarrier barrier = {};
+      barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+      barrier.srcAccessMask       = 0;
+      barrier.dstAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+      barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barrier.buffer              = buffer->handle;
+      barrier.offset              = writes[i].offset;
+      barrier.size                = writes[i].size;
+      buffers.push_back(buffer);
+      barriers.push_back(barrier);
+    }
+
+    // Barrier (Write after read)
+    vkCmdPipelineBarrier(handle, stages, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, barriers.size(), barriers.data(), 0, nullptr);
+
+    std::vector<VkBufferCopy> buffer_copies;
+    for(buffer_t buffer : buffers)
+    {
+      buffer_copies.clear();
+      for(size_t i=0, offset=0; i<write_count; offset += writes[i++].size)
+        if(writes[i].buffer == buffer && writes[i].size != 0)
+        {
+          VkBufferCopy buffer_copy = {};
+          buffer_copy.srcOffset = offset;
+          buffer_copy.dstOffset = writes[i].offset;
+          buffer_copy.size      = writes[i].size;
+          buffer_copies.push_back(buffer_copy);
+        }
+      vkCmdCopyBuffer(handle, staging_buffer->handle, buffer->handle, buffer_copies.size(), buffer_copies.data());
+    }
+
+    // Barrier (Read after write)
+    for(size_t i=0; i<buffers.size(); ++i)
+    {
+      barriers[i].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      barriers[i].dstAccessMask = get_vulkan_buffer_access(buffers[i]->type);
+    }
+    vkCmdPipelineBarrier(handle, VK_PIPELINE_STAGE_TRANSFER_BIT, stages, 0, 0, nullptr, barriers.size(), barriers.data(), 0, nullptr);
+
+    put(staging_buffer);
+  }
 }
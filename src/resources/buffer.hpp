@@ -20,4 +20,26 @@ namespace vulkan
   buffer_t buffer_create(context_t context, allocator_t allocator, BufferType type, size_t size);
   VkBuffer buffer_get_handle(buffer_t buffer);
   void buffer_write(command_buffer_t command_buffer, buffer_t buffer, const void *data, size_t size);
+
+  // Overwrite size bytes of buffer starting at offset. Unlike the overload
+  // above, this can be used on a buffer that is still in use by previously
+  // submitted commands. The data always goes through a staging buffer, even if
+  // buffer is host visible, and barriers are recorded around the copy so that
+  // it wait for earlier reads of the buffer and is visible to later ones.
+  // Staging buffers cannot be written this way.
+  void buffer_write(command_buffer_t command_buffer, buffer_t buffer, const void *data, size_t size, size_t offset);
+
+  struct BufferWrite
+  {
+    buffer_t    buffer;
+    const void *data;
+    size_t      size;
+    size_t      offset;
+  };
+
+  // Same as above for several ranges of one or more buffers at once, which
+  // share a single staging buffer, a single copy per buffer and a single pair
+  // of barriers, so that patching many small ranges cost no more allocations
+  // than patching one.
+  void buffer_write(command_buffer_t command_buffer, const BufferWrite *writes, size_t write_count);
 }
@@ -1,6 +1,21 @@
 #include "mesh.hpp"
 
-#include "tiny_obj_loader.h"
+#include "mesh_optimizer.hpp"
+#include "obj.hpp"
+
+#include "libc_check.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <assert.h>
+#include <math.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace vulkan
 {
@@ -46,6 +61,46 @@ namespace vulkan
     case VertexAttributeDescription::Type::FLOAT2: return VK_FORMAT_R32G32_SFLOAT;
     case VertexAttributeDescription::Type::FLOAT3: return VK_FORMAT_R32G32B32_SFLOAT;
     case VertexAttributeDescription::Type::FLOAT4: return VK_FORMAT_R32G32B32A32_SFLOAT;
+
+    case VertexAttributeDescription::Type::UINT1: return VK_FORMAT_R32_UINT;
+    case VertexAttributeDescription::Type::UINT2: return VK_FORMAT_R32G32_UINT;
+    case VertexAttributeDescription::Type::UINT3: return VK_FORMAT_R32G32B32_UINT;
+    case VertexAttributeDescription::Type::UINT4: return VK_FORMAT_R32G32B32A32_UINT;
+
+    case VertexAttributeDescription::Type::SINT1: return VK_FORMAT_R32_SINT;
+    case VertexAttributeDescription::Type::SINT2: return VK_FORMAT_R32G32_SINT;
+    case VertexAttributeDescription::Type::SINT3: return VK_FORMAT_R32G32B32_SINT;
+    case VertexAttributeDescription::Type::SINT4: return VK_FORMAT_R32G32B32A32_SINT;
+
+    case VertexAttributeDescription::Type::HALF1: return VK_FORMAT_R16_SFLOAT;
+    case VertexAttributeDescription::Type::HALF2: return VK_FORMAT_R16G16_SFLOAT;
+    case VertexAttributeDescription::Type::HALF4: return VK_FORMAT_R16G16B16A16_SFLOAT;
+
+    case VertexAttributeDescription::Type::UINT8X2:  return VK_FORMAT_R8G8_UINT;
+    case VertexAttributeDescription::Type::SINT8X2:  return VK_FORMAT_R8G8_SINT;
+    case VertexAttributeDescription::Type::UNORM8X2: return VK_FORMAT_R8G8_UNORM;
+    case VertexAttributeDescription::Type::SNORM8X2: return VK_FORMAT_R8G8_SNORM;
+
+    case VertexAttributeDescription::Type::UINT8X4:  return VK_FORMAT_R8G8B8A8_UINT;
+    case VertexAttributeDescription::Type::SINT8X4:  return VK_FORMAT_R8G8B8A8_SINT;
+    case VertexAttributeDescription::Type::UNORM8X4: return VK_FORMAT_R8G8B8A8_UNORM;
+    case VertexAttributeDescription::Type::SNORM8X4: return VK_FORMAT_R8G8B8A8_SNORM;
+
+    case VertexAttributeDescription::Type::UINT16X2:  return VK_FORMAT_R16G16_UINT;
+    case VertexAttributeDescription::Type::SINT16X2:  return VK_FORMAT_R16G16_SINT;
+    case VertexAttributeDescription::Type::UNORM16X2: return VK_FORMAT_R16G16_UNORM;
+    case VertexAttributeDescription::Type::SNORM16X2: return VK_FORMAT_R16G16_SNORM;
+
+    case VertexAttributeDescription::Type::UINT16X4:  return VK_FORMAT_R16G16B16A16_UINT;
+    case VertexAttributeDescription::Type::SINT16X4:  return VK_FORMAT_R16G16B16A16_SINT;
+    case VertexAttributeDescription::Type::UNORM16X4: return VK_FORMAT_R16G16B16A16_UNORM;
+    case VertexAttributeDescription::Type::SNORM16X4: return VK_FORMAT_R16G16B16A16_SNORM;
+
+    // Vulkan names components from the highest bits down
+    case VertexAttributeDescription::Type::UINT10X3_2:  return VK_FORMAT_A2B10G10R10_UINT_PACK32;
+    case VertexAttributeDescription::Type::SINT10X3_2:  return VK_FORMAT_A2B10G10R10_SINT_PACK32;
+    case VertexAttributeDescription::Type::UNORM10X3_2: return VK_FORMAT_A2B10G10R10_UNORM_PACK32;
+    case VertexAttributeDescription::Type::SNORM10X3_2: return VK_FORMAT_A2B10G10R10_SNORM_PACK32;
     default:
       fprintf(stderr, "Unknown vertex attribute type\n");
       abort();
@@ -104,14 +159,13 @@ namespace vulkan
   }
 
   static constexpr VertexAttributeDescription VERTEX_ATTRIBUTE_DESCRIPTIONS[] = {
-    { .offset = offsetof(Vertex, pos),    .type = vulkan::VertexAttributeDescription::Type::FLOAT3 },
-    { .offset = offsetof(Vertex, normal), .type = vulkan::VertexAttributeDescription::Type::FLOAT3 },
-    { .offset = offsetof(Vertex, color),  .type = vulkan::VertexAttributeDescription::Type::FLOAT3 },
-    { .offset = offsetof(Vertex, uv),     .type = vulkan::VertexAttributeDescription::Type::FLOAT2 },
+    { .offset = offsetof(QuantizedVertex, pos),    .type = vulkan::VertexAttributeDescription::Type::UNORM16X4 },
+    { .offset = offsetof(QuantizedVertex, normal), .type = vulkan::VertexAttributeDescription::Type::SNORM16X2 },
+    { .offset = offsetof(QuantizedVertex, uv),     .type = vulkan::VertexAttributeDescription::Type::HALF2     },
   };
 
   static constexpr VertexBindingDescription VERTEX_BINDING_DESCRIPTIONS[] = {{
-    .stride          = sizeof(Vertex),
+    .stride          = sizeof(QuantizedVertex),
     .attributes      = VERTEX_ATTRIBUTE_DESCRIPTIONS,
     .attribute_count = std::size(VERTEX_ATTRIBUTE_DESCRIPTIONS),
   }};
@@ -148,6 +202,8 @@ namespace vulkan
     size_t vertex_count;
     size_t index_count;
 
+    glm::mat4 transform;
+
     buffer_t *vertex_buffers;
     buffer_t index_buffer;
   };
@@ -190,6 +246,8 @@ namespace vulkan
     mesh->vertex_count = vertex_count;
     mesh->index_count  = index_count;
 
+    mesh->transform = glm::mat4(1.0f);
+
     // Vertex buffers
     const size_t vertex_buffer_count = mesh->layout->description->vertex_layout.binding_count;
     mesh->vertex_buffers = new buffer_t[vertex_buffer_count];
@@ -206,6 +264,16 @@ namespace vulkan
     return mesh;
   }
 
+  void mesh_set_transform(mesh_t mesh, const glm::mat4& transform)
+  {
+    mesh->transform = transform;
+  }
+
+  const glm::mat4& mesh_get_transform(mesh_t mesh)
+  {
+    return mesh->transform;
+  }
+
   void mesh_write(command_buffer_t command_buffer, mesh_t mesh, const void **vertices, const uint32_t *indices)
   {
     // Vertex buffers
@@ -220,52 +288,338 @@ namespace vulkan
     buffer_write(command_buffer, mesh->index_buffer, indices, sizeof(uint32_t) * mesh->index_count);
   }
 
-  mesh_t mesh_load(command_buffer_t command_buffer, context_t context, allocator_t allocator, const char *file_name)
+  void mesh_write(command_buffer_t command_buffer, mesh_t mesh,
+      const void **vertices, size_t first_vertex, size_t vertex_count,
+      const uint32_t *indices, size_t first_index, size_t index_count)
   {
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string warn, err;
-    std::vector<Vertex>   vertices;
-    std::vector<uint32_t> indices;
+    const MeshIndexWrite index_write = { indices, first_index, index_count };
+    mesh_write(command_buffer, mesh, vertices, first_vertex, vertex_count, &index_write, 1);
+  }
 
-    if(!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, file_name))
-    {
-      fprintf(stderr, "Failed to load object file:%s", err.c_str());
-      abort();
-    }
-    fprintf(stderr, "Warning:%s", warn.c_str());
+  void mesh_write(command_buffer_t command_buffer, mesh_t mesh,
+      const void **vertices, size_t first_vertex, size_t vertex_count,
+      const MeshIndexWrite *index_writes, size_t index_write_count)
+  {
+    assert(first_vertex + vertex_count <= mesh->vertex_count);
+
+    std::vector<BufferWrite> writes;
 
-    for(const auto& shape : shapes)
-      for(const auto& index : shape.mesh.indices)
+    // Vertex buffers
+    if(vertex_count != 0)
+    {
+      const size_t vertex_buffer_count = mesh->layout->description->vertex_layout.binding_count;
+      for(size_t i=0; i<vertex_buffer_count; ++i)
       {
-        Vertex vertex = {};
-        vertex.pos = {
-          attrib.vertices[3 * index.vertex_index + 0],
-          attrib.vertices[3 * index.vertex_index + 1],
-          attrib.vertices[3 * index.vertex_index + 2]
-        };
-        vertex.normal = {
-          attrib.normals[3 * index.normal_index + 0],
-          attrib.normals[3 * index.normal_index + 1],
-          attrib.normals[3 * index.normal_index + 2]
-        };
-        vertex.uv = {
-          attrib.texcoords[2 * index.texcoord_index + 0],
-          1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-        };
-        vertex.color = {1.0f, 1.0f, 1.0f};
-        vertices.push_back(vertex);
-        indices.push_back(indices.size());
+        const size_t vertex_buffer_stride = mesh->layout->description->vertex_layout.bindings[i].stride;
+        writes.push_back({ mesh->vertex_buffers[i], vertices[i], vertex_buffer_stride * vertex_count, vertex_buffer_stride * first_vertex });
       }
+    }
+
+    // Index buffers
+    for(size_t i=0; i<index_write_count; ++i)
+    {
+      const MeshIndexWrite& index_write = index_writes[i];
+      assert(index_write.first_index + index_write.index_count <= mesh->index_count);
+      if(index_write.index_count != 0)
+        writes.push_back({ mesh->index_buffer, index_write.indices, sizeof(uint32_t) * index_write.index_count, sizeof(uint32_t) * index_write.first_index });
+    }
+
+    buffer_write(command_buffer, writes.data(), writes.size());
+  }
+
+  // Quantization
+  static uint16_t quantize_unorm16(float value)
+  {
+    return (uint16_t)lrintf(std::clamp(value, 0.0f, 1.0f) * 65535.0f);
+  }
+
+  static int16_t quantize_snorm16(float value)
+  {
+    return (int16_t)lrintf(std::clamp(value, -1.0f, 1.0f) * 32767.0f);
+  }
+
+  // Round to the nearest half, ties to even, overflowing to infinity
+  static uint16_t quantize_half(float value)
+  {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof bits);
+
+    const uint32_t sign      = bits >> 16 & 0x8000;
+    const uint32_t magnitude = bits & 0x7fffffff;
+    if(magnitude > 0x7f800000) // NaN
+      return sign | 0x7e00;
+    if(magnitude >= 0x477ff000) // At least 65520, which rounds past the largest half
+      return sign | 0x7c00;
+    if(magnitude < 0x38800000) // Under 2^-14, denormal in half, counted in units of 2^-24
+      return sign | (uint16_t)lrintf(fabsf(value) * 16777216.0f);
+
+    const uint32_t rebiased = magnitude - ((127 - 15) << 23);
+    return sign | (uint16_t)((rebiased + 0xfff + (rebiased >> 13 & 1)) >> 13);
+  }
+
+  // Project the unit normal onto the octahedron |x| + |y| + |z| = 1 and
+  // unfold its lower half over the corners of the upper one, which maps the
+  // sphere onto the square [-1, 1]^2 about evenly. Zero normals end up
+  // pointing toward +z.
+  static glm::vec2 octahedral_encode(glm::vec3 normal)
+  {
+    const float l1 = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+    if(l1 == 0.0f)
+      return glm::vec2(0.0f);
+
+    glm::vec2 p = glm::vec2(normal.x, normal.y) / l1;
+    if(normal.z < 0.0f)
+      p = glm::vec2((1.0f - fabsf(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f),
+                    (1.0f - fabsf(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f));
+    return p;
+  }
+
+  // Position of the corner of the bounding box of the mesh with the lowest
+  // coordinates, and length of its largest side, which quantized positions
+  // are relative to. The same scale is used along every axis so that normals
+  // are still transformed correctly once it is folded into the model matrix.
+  struct MeshQuantization
+  {
+    glm::vec3 offset;
+    float     scale;
+  };
+
+  static glm::mat4 mesh_quantization_transform(const MeshQuantization& quantization)
+  {
+    glm::mat4 transform = glm::mat4(quantization.scale);
+    transform[3] = glm::vec4(quantization.offset, 1.0f);
+    return transform;
+  }
+
+  static MeshQuantization mesh_quantize(const std::vector<Vertex>& vertices, std::vector<QuantizedVertex>& quantized_vertices)
+  {
+    glm::vec3 min = glm::vec3(INFINITY);
+    glm::vec3 max = glm::vec3(-INFINITY);
+    for(const Vertex& vertex : vertices)
+    {
+      min = glm::min(min, vertex.pos);
+      max = glm::max(max, vertex.pos);
+    }
+
+    MeshQuantization quantization = {};
+    if(!vertices.empty())
+    {
+      const glm::vec3 extent = max - min;
+      quantization.offset = min;
+      quantization.scale  = std::max({extent.x, extent.y, extent.z});
+    }
+    if(quantization.scale == 0.0f)
+      quantization.scale = 1.0f;
+
+    quantized_vertices.resize(vertices.size());
+    for(size_t i=0; i<vertices.size(); ++i)
+    {
+      const Vertex&    vertex   = vertices[i];
+      QuantizedVertex& quantized = quantized_vertices[i];
+
+      const glm::vec3 pos    = (vertex.pos - quantization.offset) / quantization.scale;
+      const glm::vec2 normal = octahedral_encode(vertex.normal);
+      quantized.pos[0]    = quantize_unorm16(pos.x);
+      quantized.pos[1]    = quantize_unorm16(pos.y);
+      quantized.pos[2]    = quantize_unorm16(pos.z);
+      quantized.pos[3]    = 0;
+      quantized.normal[0] = quantize_snorm16(normal.x);
+      quantized.normal[1] = quantize_snorm16(normal.y);
+      quantized.uv[0]     = quantize_half(vertex.uv.x);
+      quantized.uv[1]     = quantize_half(vertex.uv.y);
+    }
+    return quantization;
+  }
+
+  // Binary cache of a loaded mesh, written next to its OBJ file with
+  // MESH_CACHE_EXTENSION appended to the name:
+  //
+  //   MeshCacheHeader header
+  //   QuantizedVertex vertices[header.vertex_count]
+  //   uint32_t        indices[header.index_count]
+  //
+  // A cache is only used if its version, vertex size and flags match ours and
+  // if the OBJ file has not changed since it was written, going by its size
+  // and modification time. Anything else is treated as a miss and the cache
+  // is written again.
+  static constexpr const char *MESH_CACHE_EXTENSION = ".mesh";
+  static constexpr uint32_t    MESH_CACHE_MAGIC     = 0x534d5856; // "VXMS"
+  static constexpr uint32_t    MESH_CACHE_VERSION   = 2;
+
+  static constexpr uint32_t MESH_CACHE_OPTIMIZED = 1 << 0; // Went through mesh_optimize
+
+  struct MeshCacheHeader
+  {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertex_size;
+    uint32_t vertex_count;
+    uint32_t index_count;
+    uint32_t flags;
+    uint64_t source_size;
+    int64_t  source_mtime; // In nanoseconds
+    float    offset[3];    // MeshQuantization of the vertices
+    float    scale;
+  };
+  static_assert(sizeof(MeshCacheHeader) == 56);
+
+  static void mesh_cache_stamp(const struct stat& source, MeshCacheHeader& header)
+  {
+    header.source_size  = source.st_size;
+    header.source_mtime = (int64_t)source.st_mtim.tv_sec * 1000000000 + source.st_mtim.tv_nsec;
+  }
+
+  // Create the mesh straight from a mapping of the cache, or return nullptr
+  // if there is no usable cache.
+  static mesh_t mesh_cache_load(command_buffer_t command_buffer, context_t context, allocator_t allocator, const char *path, const struct stat& source, uint32_t flags)
+  {
+    const int fd = open(path, O_RDONLY);
+    if(fd < 0)
+      return nullptr;
+
+    struct stat st;
+    LIBC_CHECK(fstat(fd, &st));
+    if((size_t)st.st_size < sizeof(MeshCacheHeader))
+    {
+      LIBC_CHECK(close(fd));
+      return nullptr;
+    }
+
+    void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    LIBC_CHECK(close(fd));
+    if(mapping == MAP_FAILED)
+    {
+      perror("mmap");
+      return nullptr;
+    }
+
+    const MeshCacheHeader *header = static_cast<const MeshCacheHeader *>(mapping);
+
+    MeshCacheHeader expected = {};
+    mesh_cache_stamp(source, expected);
+
+    mesh_t mesh = nullptr;
+    if(header->magic        == MESH_CACHE_MAGIC
+    && header->version      == MESH_CACHE_VERSION
+    && header->vertex_size  == sizeof(QuantizedVertex)
+    && header->flags        == flags
+    && header->source_size  == expected.source_size
+    && header->source_mtime == expected.source_mtime
+    && (size_t)st.st_size   == sizeof(MeshCacheHeader) + header->vertex_count * sizeof(QuantizedVertex) + header->index_count * sizeof(uint32_t))
+    {
+      const char     *bytes    = static_cast<const char *>(mapping);
+      const void     *vertices = bytes + sizeof(MeshCacheHeader);
+      const uint32_t *indices  = reinterpret_cast<const uint32_t *>(bytes + sizeof(MeshCacheHeader) + header->vertex_count * sizeof(QuantizedVertex));
+
+      MeshQuantization quantization;
+      quantization.offset = glm::vec3(header->offset[0], header->offset[1], header->offset[2]);
+      quantization.scale  = header->scale;
+
+      mesh_layout_t mesh_layout = mesh_layout_create_default();
+      mesh = mesh_create(context, allocator, mesh_layout, header->vertex_count, header->index_count);
+      put(mesh_layout);
+
+      const void *_vertices[] = { vertices };
+      mesh_write(command_buffer, mesh, _vertices, indices);
+      mesh_set_transform(mesh, mesh_quantization_transform(quantization));
+    }
+
+    LIBC_CHECK(munmap(mapping, st.st_size));
+    return mesh;
+  }
+
+  static bool mesh_cache_write_all(int fd, const void *data, size_t size)
+  {
+    const char *bytes = static_cast<const char *>(data);
+    while(size != 0)
+    {
+      const ssize_t written = write(fd, bytes, size);
+      if(written < 0)
+        return false;
+
+      bytes += written;
+      size  -= written;
+    }
+    return true;
+  }
+
+  // Failing to write the cache is not fatal, the OBJ file is simply parsed
+  // again next time. The cache is written to a temporary file first so that
+  // a reader never see it half written.
+  static void mesh_cache_write(const char *path, const struct stat& source, uint32_t flags, const MeshQuantization& quantization, const std::vector<QuantizedVertex>& vertices, const std::vector<uint32_t>& indices)
+  {
+    MeshCacheHeader header = {};
+    header.magic        = MESH_CACHE_MAGIC;
+    header.version      = MESH_CACHE_VERSION;
+    header.vertex_size  = sizeof(QuantizedVertex);
+    header.vertex_count = vertices.size();
+    header.index_count  = indices.size();
+    header.flags        = flags;
+    header.offset[0]    = quantization.offset.x;
+    header.offset[1]    = quantization.offset.y;
+    header.offset[2]    = quantization.offset.z;
+    header.scale        = quantization.scale;
+    mesh_cache_stamp(source, header);
+
+    const std::string temporary_path = std::string(path) + ".tmp";
+    const int fd = open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0)
+    {
+      perror(temporary_path.c_str());
+      return;
+    }
+
+    const bool written = mesh_cache_write_all(fd, &header, sizeof header)
+                      && mesh_cache_write_all(fd, vertices.data(), vertices.size() * sizeof(QuantizedVertex))
+                      && mesh_cache_write_all(fd, indices.data(), indices.size() * sizeof(uint32_t));
+    LIBC_CHECK(close(fd));
+
+    if(!written || rename(temporary_path.c_str(), path) != 0)
+    {
+      perror(path);
+      unlink(temporary_path.c_str());
+    }
+  }
+
+  // Reorder the triangles for the vertex cache and then for overdraw, and
+  // the vertices in the order they are used. See bench/mesh_optimizer.cpp for
+  // what each step gains.
+  static void mesh_optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+  {
+    mesh_optimize_vertex_cache(indices.data(), indices.size(), vertices.size());
+    mesh_optimize_overdraw(indices.data(), indices.size(), &vertices[0].pos.x, sizeof(Vertex), vertices.size());
+    vertices.resize(mesh_optimize_vertex_fetch(vertices.data(), sizeof(Vertex), vertices.size(), indices.data(), indices.size()));
+  }
+
+  mesh_t mesh_load(command_buffer_t command_buffer, context_t context, allocator_t allocator, const char *file_name, bool optimize)
+  {
+    struct stat source;
+    LIBC_CHECK(stat(file_name, &source));
+
+    const uint32_t    flags      = optimize ? MESH_CACHE_OPTIMIZED : 0;
+    const std::string cache_path = std::string(file_name) + MESH_CACHE_EXTENSION;
+    if(mesh_t mesh = mesh_cache_load(command_buffer, context, allocator, cache_path.c_str(), source, flags))
+      return mesh;
+
+    std::vector<Vertex>   vertices;
+    std::vector<uint32_t> indices;
+    obj_parse(file_name, vertices, indices);
+    if(optimize && !indices.empty())
+      mesh_optimize(vertices, indices);
+
+    std::vector<QuantizedVertex> quantized_vertices;
+    const MeshQuantization quantization = mesh_quantize(vertices, quantized_vertices);
 
     mesh_layout_t mesh_layout = mesh_layout_create_default();
-    mesh_t        mesh        = mesh_create(context, allocator, mesh_layout, vertices.size(), indices.size());
+    mesh_t        mesh        = mesh_create(context, allocator, mesh_layout, quantized_vertices.size(), indices.size());
     put(mesh_layout);
 
     const uint32_t *_indices    = indices.data();
-    const void     *_vertices[] = { vertices.data() };
+    const void     *_vertices[] = { quantized_vertices.data() };
     mesh_write(command_buffer, mesh, _vertices, _indices);
+    mesh_set_transform(mesh, mesh_quantization_transform(quantization));
+
+    mesh_cache_write(cache_path.c_str(), source, flags, quantization, quantized_vertices, indices);
     return mesh;
   }
 
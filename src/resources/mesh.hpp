@@ -15,7 +15,27 @@ namespace vulkan
   {
     enum class Type
     {
-      FLOAT1, FLOAT2, FLOAT3, FLOAT4 // Which maniac who not use float as vertex input anyway?
+      FLOAT1, FLOAT2, FLOAT3, FLOAT4, // Which maniac who not use float as vertex input anyway?
+
+      // 32-bit integers, read as is for the vertex shader to decode, such as
+      // the bit fields of VoxelVertex
+      UINT1, UINT2, UINT3, UINT4,
+      SINT1, SINT2, SINT3, SINT4,
+
+      // 16-bit floats. There is no HALF3, 3 components of 16 bits are rarely
+      // supported for vertex buffers.
+      HALF1, HALF2, HALF4,
+
+      // 2 or 4 8-bit or 16-bit components, either read as integers or
+      // normalized to [0, 1] for unsigned and [-1, 1] for signed components
+      UINT8X2,  SINT8X2,  UNORM8X2,  SNORM8X2,
+      UINT8X4,  SINT8X4,  UNORM8X4,  SNORM8X4,
+      UINT16X2, SINT16X2, UNORM16X2, SNORM16X2,
+      UINT16X4, SINT16X4, UNORM16X4, SNORM16X4,
+
+      // 3 10-bit components and a 2-bit one packed into 32 bits, with x in
+      // the lowest bits, read the same way
+      UINT10X3_2, SINT10X3_2, UNORM10X3_2, SNORM10X3_2,
     };
 
     size_t offset;
@@ -58,9 +78,60 @@ namespace vulkan
     glm::vec2 uv;
   };
 
+  // Vertex as stored by meshes loaded with mesh_load, in 16 bytes instead of
+  // 44, and described by mesh_layout_create_default:
+  //
+  //   pos    UNORM16X4, scaled to fit the mesh into [0, 1] along its largest
+  //          side, which mesh_get_transform undo, w unused
+  //   normal SNORM16X2, octahedral encoding of the unit normal
+  //   uv     HALF2
+  //
+  // Vertex colors are dropped, OBJ files being loaded as white.
+  struct QuantizedVertex
+  {
+    uint16_t pos[4];
+    int16_t  normal[2];
+    uint16_t uv[2];
+  };
+  static_assert(sizeof(QuantizedVertex) == 16);
+
   mesh_t mesh_create(context_t context, allocator_t allocator, mesh_layout_t mesh_layout, size_t vertex_count, size_t index_count);
+
+  // Transform from the space of the vertex positions to model space, which
+  // the renderer applies before the model matrix. Identity unless the
+  // positions are quantized.
+  void mesh_set_transform(mesh_t mesh, const glm::mat4& transform);
+  const glm::mat4& mesh_get_transform(mesh_t mesh);
   void mesh_write(command_buffer_t command_buffer, mesh_t mesh, const void **vertices, const uint32_t *indices);
-  mesh_t mesh_load(command_buffer_t command_buffer, context_t context, allocator_t allocator, const char *file_name);
+
+  // Overwrite vertex_count vertices starting at first_vertex and index_count
+  // indices starting at first_index, leaving the rest of the mesh untouched.
+  // The mesh may still be in use by previously submitted commands.
+  void mesh_write(command_buffer_t command_buffer, mesh_t mesh,
+      const void **vertices, size_t first_vertex, size_t vertex_count,
+      const uint32_t *indices, size_t first_index, size_t index_count);
+
+  struct MeshIndexWrite
+  {
+    const uint32_t *indices;
+    size_t          first_index;
+    size_t          index_count;
+  };
+
+  // Same as above for several ranges of indices at once, all of which go
+  // through a single staging buffer along with the vertices.
+  void mesh_write(command_buffer_t command_buffer, mesh_t mesh,
+      const void **vertices, size_t first_vertex, size_t vertex_count,
+      const MeshIndexWrite *index_writes, size_t index_write_count);
+
+  // Load an OBJ file, welding together the vertices that share the same
+  // position, normal and uv so that each is only stored and transformed once.
+  // If optimize is set, triangles and vertices are then reordered for the
+  // vertex cache, overdraw and vertex fetch, see mesh_optimizer.hpp. Vertices
+  // are quantized to QuantizedVertex. The result is cached in a binary file
+  // next to it, which later loads map and upload as is instead of parsing the
+  // OBJ file again.
+  mesh_t mesh_load(command_buffer_t command_buffer, context_t context, allocator_t allocator, const char *file_name, bool optimize = true);
 
   buffer_t *mesh_get_vertex_buffers(mesh_t mesh, size_t& count);
   buffer_t mesh_get_index_buffer(mesh_t mesh);
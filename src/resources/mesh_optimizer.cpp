@@ -0,0 +1,321 @@
+#include "mesh_optimizer.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include <assert.h>
+#include <string.h>
+
+namespace vulkan
+{
+  // FIFO cache simulated with one timestamp per vertex. A vertex is in the
+  // cache if fewer than cache_size vertices were pushed since itself was.
+  struct VertexCache
+  {
+    std::vector<uint32_t> timestamps;
+    uint32_t              time;
+  };
+
+  static VertexCache vertex_cache_create(size_t vertex_count)
+  {
+    VertexCache cache;
+    cache.timestamps.assign(vertex_count, 0);
+    cache.time = MESH_OPTIMIZER_CACHE_SIZE + 1;
+    return cache;
+  }
+
+  static void vertex_cache_flush(VertexCache& cache)
+  {
+    cache.time += MESH_OPTIMIZER_CACHE_SIZE + 1;
+  }
+
+  static bool vertex_cache_contains(const VertexCache& cache, uint32_t vertex)
+  {
+    return cache.time - cache.timestamps[vertex] <= MESH_OPTIMIZER_CACHE_SIZE;
+  }
+
+  // Return the number of misses
+  static unsigned vertex_cache_push_triangle(VertexCache& cache, const uint32_t *triangle)
+  {
+    unsigned misses = 0;
+    for(size_t i=0; i<3; ++i)
+      if(!vertex_cache_contains(cache, triangle[i]))
+      {
+        cache.timestamps[triangle[i]] = cache.time++;
+        ++misses;
+      }
+    return misses;
+  }
+
+  VertexCacheStatistics mesh_analyze_vertex_cache(const uint32_t *indices, size_t index_count, size_t vertex_count)
+  {
+    assert(index_count % 3 == 0);
+
+    VertexCache       cache = vertex_cache_create(vertex_count);
+    std::vector<bool> used(vertex_count, false);
+
+    size_t misses     = 0;
+    size_t used_count = 0;
+    for(size_t i=0; i<index_count; i+=3)
+    {
+      misses += vertex_cache_push_triangle(cache, &indices[i]);
+      for(size_t j=0; j<3; ++j)
+        if(!used[indices[i+j]])
+        {
+          used[indices[i+j]] = true;
+          ++used_count;
+        }
+    }
+
+    VertexCacheStatistics statistics = {};
+    if(index_count != 0)
+    {
+      statistics.acmr = (float)misses / (float)(index_count / 3);
+      statistics.atvr = (float)misses / (float)used_count;
+    }
+    return statistics;
+  }
+
+  void mesh_optimize_vertex_cache(uint32_t *indices, size_t index_count, size_t vertex_count)
+  {
+    assert(index_count % 3 == 0);
+    const size_t triangle_count = index_count / 3;
+    if(triangle_count == 0)
+      return;
+
+    // Triangles around each vertex, with the number of those not emitted yet
+    std::vector<uint32_t> live(vertex_count, 0);
+    for(size_t i=0; i<index_count; ++i)
+      ++live[indices[i]];
+
+    std::vector<uint32_t> offsets(vertex_count + 1, 0);
+    for(size_t vertex=0; vertex<vertex_count; ++vertex)
+      offsets[vertex+1] = offsets[vertex] + live[vertex];
+
+    std::vector<uint32_t> adjacency(index_count);
+    {
+      std::vector<uint32_t> cursors(offsets.begin(), offsets.end() - 1);
+      for(size_t i=0; i<index_count; ++i)
+        adjacency[cursors[indices[i]]++] = i / 3;
+    }
+
+    VertexCache           cache = vertex_cache_create(vertex_count);
+    std::vector<bool>     emitted(triangle_count, false);
+    std::vector<uint32_t> dead_ends;  // Vertices of emitted triangles, most recent last
+    std::vector<uint32_t> candidates; // Vertices of the triangles emitted around the current vertex
+    std::vector<uint32_t> result;
+    result.reserve(index_count);
+
+    // Where to resume looking for a vertex with triangles left once both the
+    // candidates and the dead-end stack are exhausted
+    size_t cursor = 0;
+
+    const auto skip_dead_end = [&]() -> int64_t {
+      while(!dead_ends.empty())
+      {
+        const uint32_t vertex = dead_ends.back();
+        dead_ends.pop_back();
+        if(live[vertex] != 0)
+          return vertex;
+      }
+
+      for(; cursor < vertex_count; ++cursor)
+        if(live[cursor] != 0)
+          return cursor;
+
+      return -1;
+    };
+
+    // Fan around each vertex in turn, emitting all of its remaining
+    // triangles, then move on to the neighbour that was pushed into the cache
+    // the longest ago but will still be in it once its own triangles are
+    // emitted. If no neighbour would still be in the cache, fall back to the
+    // dead-end stack instead.
+    for(int64_t vertex = skip_dead_end(); vertex >= 0;)
+    {
+      candidates.clear();
+      for(uint32_t k=offsets[vertex]; k<offsets[vertex+1]; ++k)
+      {
+        const uint32_t triangle = adjacency[k];
+        if(emitted[triangle])
+          continue;
+
+        const uint32_t *corners = &indices[3 * triangle];
+        for(size_t i=0; i<3; ++i)
+        {
+          result.push_back(corners[i]);
+          dead_ends.push_back(corners[i]);
+          candidates.push_back(corners[i]);
+          --live[corners[i]];
+        }
+        vertex_cache_push_triangle(cache, corners);
+        emitted[triangle] = true;
+      }
+
+      int64_t next          = -1;
+      int64_t best_priority = 0;
+      for(uint32_t candidate : candidates)
+      {
+        if(live[candidate] == 0)
+          continue;
+
+        const int64_t age      = cache.time - cache.timestamps[candidate];
+        const int64_t priority = age + 2 * live[candidate] <= (int64_t)MESH_OPTIMIZER_CACHE_SIZE ? age : 0;
+        if(priority > best_priority)
+        {
+          best_priority = priority;
+          next          = candidate;
+        }
+      }
+      vertex = next >= 0 ? next : skip_dead_end();
+    }
+
+    assert(result.size() == index_count);
+    std::copy(result.begin(), result.end(), indices);
+  }
+
+  struct MeshCluster
+  {
+    uint32_t first_triangle;
+    uint32_t triangle_count;
+    float    sort_key;
+  };
+
+  // Split the triangle list wherever all three vertices of a triangle miss
+  // the cache, meaning that it was as good as flushed, and then split these
+  // again wherever the cache efficiency of what came before in the same
+  // piece is within threshold of that of the whole piece.
+  static std::vector<MeshCluster> mesh_overdraw_clusters(const uint32_t *indices, size_t triangle_count, size_t vertex_count, float threshold)
+  {
+    VertexCache           cache = vertex_cache_create(vertex_count);
+    std::vector<uint32_t> hard_boundaries;
+    for(size_t triangle=0; triangle<triangle_count; ++triangle)
+      if(vertex_cache_push_triangle(cache, &indices[3 * triangle]) == 3)
+        hard_boundaries.push_back(triangle);
+    hard_boundaries.push_back(triangle_count);
+
+    std::vector<MeshCluster> clusters;
+    for(size_t i=0; i+1<hard_boundaries.size(); ++i)
+    {
+      const size_t begin = hard_boundaries[i];
+      const size_t end   = hard_boundaries[i+1];
+
+      vertex_cache_flush(cache);
+      size_t misses = 0;
+      for(size_t triangle=begin; triangle<end; ++triangle)
+        misses += vertex_cache_push_triangle(cache, &indices[3 * triangle]);
+      const float target = threshold * (float)misses / (float)(end - begin);
+
+      vertex_cache_flush(cache);
+      size_t first = begin;
+      misses = 0;
+      for(size_t triangle=begin; triangle<end; ++triangle)
+      {
+        misses += vertex_cache_push_triangle(cache, &indices[3 * triangle]);
+        if(triangle + 1 == end || (float)misses / (float)(triangle + 1 - first) <= target)
+        {
+          clusters.push_back(MeshCluster{ (uint32_t)first, (uint32_t)(triangle + 1 - first), 0.0f });
+          vertex_cache_flush(cache);
+          first  = triangle + 1;
+          misses = 0;
+        }
+      }
+    }
+    return clusters;
+  }
+
+  void mesh_optimize_overdraw(uint32_t *indices, size_t index_count, const float *positions, size_t stride, size_t vertex_count, float threshold)
+  {
+    assert(index_count % 3 == 0);
+    const size_t triangle_count = index_count / 3;
+    if(triangle_count == 0)
+      return;
+
+    const auto position = [&](uint32_t vertex) {
+      const float *p = reinterpret_cast<const float *>(reinterpret_cast<const char *>(positions) + vertex * stride);
+      return glm::vec3(p[0], p[1], p[2]);
+    };
+
+    // Twice the area weighted normal and three times the area weighted
+    // centroid of a triangle, the factors cancelling out once normalized
+    const auto triangle_moments = [&](size_t triangle, glm::vec3& normal, glm::vec3& centroid, float& area) {
+      const glm::vec3 a = position(indices[3 * triangle + 0]);
+      const glm::vec3 b = position(indices[3 * triangle + 1]);
+      const glm::vec3 c = position(indices[3 * triangle + 2]);
+      normal   = glm::cross(b - a, c - a);
+      area     = glm::length(normal);
+      centroid = (a + b + c) * area;
+    };
+
+    glm::vec3 mesh_centroid = glm::vec3(0.0f);
+    float     mesh_area     = 0.0f;
+    for(size_t triangle=0; triangle<triangle_count; ++triangle)
+    {
+      glm::vec3 normal, centroid;
+      float area;
+      triangle_moments(triangle, normal, centroid, area);
+      mesh_centroid += centroid;
+      mesh_area     += area;
+    }
+    if(mesh_area > 0.0f)
+      mesh_centroid /= 3.0f * mesh_area;
+
+    // Clusters facing away from the center of the mesh are the most likely
+    // to occlude the others, whichever side the mesh is seen from
+    std::vector<MeshCluster> clusters = mesh_overdraw_clusters(indices, triangle_count, vertex_count, threshold);
+    for(MeshCluster& cluster : clusters)
+    {
+      glm::vec3 cluster_normal   = glm::vec3(0.0f);
+      glm::vec3 cluster_centroid = glm::vec3(0.0f);
+      float     cluster_area     = 0.0f;
+      for(size_t triangle=cluster.first_triangle; triangle<cluster.first_triangle + cluster.triangle_count; ++triangle)
+      {
+        glm::vec3 normal, centroid;
+        float area;
+        triangle_moments(triangle, normal, centroid, area);
+        cluster_normal   += normal;
+        cluster_centroid += centroid;
+        cluster_area     += area;
+      }
+
+      const float normal_length = glm::length(cluster_normal);
+      if(cluster_area > 0.0f && normal_length > 0.0f)
+        cluster.sort_key = glm::dot(cluster_centroid / (3.0f * cluster_area) - mesh_centroid, cluster_normal / normal_length);
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(), [](const MeshCluster& a, const MeshCluster& b) { return a.sort_key > b.sort_key; });
+
+    std::vector<uint32_t> result;
+    result.reserve(index_count);
+    for(const MeshCluster& cluster : clusters)
+      result.insert(result.end(), &indices[3 * cluster.first_triangle], &indices[3 * (cluster.first_triangle + cluster.triangle_count)]);
+
+    assert(result.size() == index_count);
+    std::copy(result.begin(), result.end(), indices);
+  }
+
+  size_t mesh_optimize_vertex_fetch(void *vertices, size_t vertex_size, size_t vertex_count, uint32_t *indices, size_t index_count)
+  {
+    static constexpr uint32_t UNUSED = UINT32_MAX;
+
+    std::vector<uint32_t> remap(vertex_count, UNUSED);
+    uint32_t used_count = 0;
+    for(size_t i=0; i<index_count; ++i)
+    {
+      uint32_t& index = remap[indices[i]];
+      if(index == UNUSED)
+        index = used_count++;
+      indices[i] = index;
+    }
+
+    char *bytes = static_cast<char *>(vertices);
+    std::vector<char> original(bytes, bytes + vertex_count * vertex_size);
+    for(size_t vertex=0; vertex<vertex_count; ++vertex)
+      if(remap[vertex] != UNUSED)
+        memcpy(bytes + remap[vertex] * vertex_size, &original[vertex * vertex_size], vertex_size);
+
+    return used_count;
+  }
+}
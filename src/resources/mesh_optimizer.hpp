@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace vulkan
+{
+  // Size of the FIFO post-transform cache everything here optimizes for and
+  // is measured against, on the small side so that the result holds up on
+  // most GPUs.
+  static constexpr size_t MESH_OPTIMIZER_CACHE_SIZE = 16;
+
+  // Overdraw ordering may lose this much of the vertex cache efficiency
+  // gained by mesh_optimize_vertex_cache, as a ratio of ACMR.
+  static constexpr float MESH_OPTIMIZER_OVERDRAW_THRESHOLD = 1.05f;
+
+  struct VertexCacheStatistics
+  {
+    float acmr; // Average cache misses per triangle, 0.5 at best and 3 at worst
+    float atvr; // Average transformed vertices per vertex used, 1 at best
+  };
+
+  // Simulate a FIFO cache of MESH_OPTIMIZER_CACHE_SIZE vertices on the
+  // triangle list in indices, referring to vertex_count vertices.
+  VertexCacheStatistics mesh_analyze_vertex_cache(const uint32_t *indices, size_t index_count, size_t vertex_count);
+
+  // Reorder the triangles of the triangle list in indices in place so that
+  // triangles sharing vertices are drawn close together, with Tipsify
+  // (Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex
+  // Locality and Reduced Overdraw", 2007), which runs in linear time.
+  void mesh_optimize_vertex_cache(uint32_t *indices, size_t index_count, size_t vertex_count);
+
+  // Reorder the triangles of a triangle list already ordered by
+  // mesh_optimize_vertex_cache so that the parts of the mesh most likely to
+  // occlude the others are drawn first, from whatever side the mesh is seen.
+  // The list is cut into clusters where the vertex cache is flushed anyway,
+  // or where cutting cost little cache efficiency as set by threshold, and
+  // clusters are sorted by how far they face out from the center of the
+  // mesh. The position of vertex i is the three floats at positions + i *
+  // stride bytes.
+  void mesh_optimize_overdraw(uint32_t *indices, size_t index_count, const float *positions, size_t stride, size_t vertex_count, float threshold = MESH_OPTIMIZER_OVERDRAW_THRESHOLD);
+
+  // Renumber the vertices in the order they are first used by indices so
+  // that vertices are fetched from memory mostly sequentially, moving them
+  // in place. Vertices that are not used are dropped. Return the number of
+  // vertices left.
+  size_t mesh_optimize_vertex_fetch(void *vertices, size_t vertex_size, size_t vertex_count, uint32_t *indices, size_t index_count);
+}
@@ -0,0 +1,604 @@
+#include "obj.hpp"
+
+#include "libc_check.hpp"
+#include "tiny_obj_loader.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace vulkan
+{
+  // Positions, uvs and normals, in the order they appear in a face corner
+  static constexpr size_t OBJ_POSITION = 0;
+  static constexpr size_t OBJ_UV       = 1;
+  static constexpr size_t OBJ_NORMAL   = 2;
+  static constexpr size_t OBJ_COMPONENT_COUNTS[3] = { 3, 2, 3 };
+
+  static constexpr uint32_t OBJ_MISSING = UINT32_MAX;
+
+  // Attributes a vertex is made of, as indices counted from 0 into the
+  // attributes of the whole file, or OBJ_MISSING. Faces are kept in this
+  // form until vertices are welded, which is much smaller than a Vertex, and
+  // vertices are only built once for each distinct combination.
+  struct ObjVertex
+  {
+    uint32_t indices[3];
+  };
+
+  static uint64_t vertex_hash(const uint32_t *words, size_t word_count)
+  {
+    uint64_t hash = 0;
+    for(size_t i=0; i<word_count; ++i)
+    {
+      hash = (hash ^ words[i]) * 0x9e3779b97f4a7c15;
+      hash ^= hash >> 32;
+    }
+    return hash;
+  }
+
+  static uint64_t vertex_hash(const ObjVertex& vertex)
+  {
+    return vertex_hash(vertex.indices, 3);
+  }
+
+  static uint64_t vertex_hash(const Vertex& vertex)
+  {
+    uint32_t words[sizeof(Vertex) / sizeof(uint32_t)];
+    memcpy(words, &vertex, sizeof words);
+    return vertex_hash(words, std::size(words));
+  }
+
+  // Open addressing set of the vertices pushed so far, indexing into vertices
+  // and probed linearly, used to weld identical vertices together.
+  struct VertexWelder
+  {
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    std::vector<uint32_t> slots;
+    uint64_t              mask;
+  };
+
+  static VertexWelder vertex_welder_create(size_t max_vertex_count)
+  {
+    // Keep the load factor under one half
+    const size_t slot_count = std::bit_ceil(2 * max_vertex_count + 1);
+
+    VertexWelder welder;
+    welder.slots.assign(slot_count, VertexWelder::EMPTY);
+    welder.mask = slot_count - 1;
+    return welder;
+  }
+
+  // Return the index of vertex, pushing it first unless an identical one
+  // already is.
+  template<typename T>
+  static uint32_t vertex_welder_insert(VertexWelder& welder, std::vector<T>& vertices, const T& vertex)
+  {
+    for(uint64_t i = vertex_hash(vertex) & welder.mask;; i = (i + 1) & welder.mask)
+    {
+      const uint32_t index = welder.slots[i];
+      if(index == VertexWelder::EMPTY)
+      {
+        welder.slots[i] = vertices.size();
+        vertices.push_back(vertex);
+        return welder.slots[i];
+      }
+
+      if(memcmp(&vertices[index], &vertex, sizeof(T)) == 0)
+        return index;
+    }
+  }
+
+  // Build the welded vertices out of the attributes they refer to, with
+  // missing normals and uvs left as zero.
+  static void obj_build_vertices(const std::vector<ObjVertex>& obj_vertices, const float *attributes[3], std::vector<Vertex>& vertices)
+  {
+    vertices.resize(obj_vertices.size());
+    for(size_t i=0; i<obj_vertices.size(); ++i)
+    {
+      const uint32_t *indices = obj_vertices[i].indices;
+
+      Vertex vertex = {};
+      const float *position = &attributes[OBJ_POSITION][3 * indices[OBJ_POSITION]];
+      vertex.pos = { position[0], position[1], position[2] };
+      if(indices[OBJ_NORMAL] != OBJ_MISSING)
+      {
+        const float *normal = &attributes[OBJ_NORMAL][3 * indices[OBJ_NORMAL]];
+        vertex.normal = { normal[0], normal[1], normal[2] };
+      }
+      if(indices[OBJ_UV] != OBJ_MISSING)
+      {
+        const float *uv = &attributes[OBJ_UV][2 * indices[OBJ_UV]];
+        vertex.uv = { uv[0], 1.0f - uv[1] };
+      }
+      vertex.color = {1.0f, 1.0f, 1.0f};
+      vertices[i] = vertex;
+    }
+  }
+
+  // Weld the built vertices again, this time by value, since files often
+  // repeat the same attribute under several indices, such as a normal written
+  // out once per face. Vertices keep the order of their first use.
+  static void obj_weld_vertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+  {
+    VertexWelder          welder = vertex_welder_create(vertices.size());
+    std::vector<Vertex>   welded;
+    std::vector<uint32_t> remap(vertices.size());
+    for(size_t i=0; i<vertices.size(); ++i)
+      remap[i] = vertex_welder_insert(welder, welded, vertices[i]);
+
+    if(welded.size() == vertices.size())
+      return;
+
+    for(uint32_t& index : indices)
+      index = remap[index];
+    vertices = std::move(welded);
+  }
+
+  void obj_parse_tinyobj(const char *file_name, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+  {
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+
+    if(!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, file_name))
+    {
+      fprintf(stderr, "Failed to load object file:%s", err.c_str());
+      abort();
+    }
+    fprintf(stderr, "Warning:%s", warn.c_str());
+
+    size_t index_count = 0;
+    for(const auto& shape : shapes)
+      index_count += shape.mesh.indices.size();
+
+    VertexWelder           welder = vertex_welder_create(index_count);
+    std::vector<ObjVertex> obj_vertices;
+    indices.reserve(index_count);
+
+    const auto obj_index = [](int index) { return index >= 0 ? (uint32_t)index : OBJ_MISSING; };
+    for(const auto& shape : shapes)
+      for(const auto& index : shape.mesh.indices)
+      {
+        const ObjVertex vertex = { { obj_index(index.vertex_index), obj_index(index.texcoord_index), obj_index(index.normal_index) } };
+        indices.push_back(vertex_welder_insert(welder, obj_vertices, vertex));
+      }
+
+    const float *attributes[3] = { attrib.vertices.data(), attrib.texcoords.data(), attrib.normals.data() };
+    obj_build_vertices(obj_vertices, attributes, vertices);
+    obj_weld_vertices(vertices, indices);
+  }
+
+  // Slices smaller than this are not worth a thread of their own
+  static constexpr size_t OBJ_MIN_SLICE_SIZE = 1 << 20;
+
+  static constexpr int32_t OBJ_NO_INDEX = INT32_MIN;
+
+  // Corner of a face as written in the file, with indices counted from 0.
+  // Negative indices count back from the last element of their kind defined
+  // so far, which is only known once every slice before has been parsed, so
+  // they are stored relative to the start of the slice until then.
+  struct ObjCorner
+  {
+    int32_t indices[3]; // OBJ_NO_INDEX if missing
+    uint8_t relative;   // Bit i set if indices[i] is relative to the slice
+  };
+
+  struct ObjSlice
+  {
+    const char *begin;
+    const char *end;
+    const char *error; // Line that failed to parse, or nullptr
+
+    std::vector<float>     attributes[3];
+    std::vector<ObjCorner> corners;
+    std::vector<uint32_t>  face_sizes;
+
+    size_t bases[3]; // Number of elements of each kind defined before the slice
+
+    // Corners of the triangles of the slice, waiting to be welded
+    std::vector<ObjVertex> vertices;
+  };
+
+  static bool obj_is_space(char c)
+  {
+    return c == ' ' || c == '\t' || c == '\r';
+  }
+
+  static bool obj_is_digit(char c)
+  {
+    return c >= '0' && c <= '9';
+  }
+
+  static const char *obj_skip_spaces(const char *s, const char *end)
+  {
+    while(s != end && obj_is_space(*s))
+      ++s;
+    return s;
+  }
+
+  // Exactly representable as doubles
+  static constexpr double OBJ_POWERS_OF_TEN[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+  };
+
+  // Parse a decimal number such as -1.25e-3 at s, returning where it ends or
+  // nullptr if there is none. Digits are accumulated into an integer and
+  // scaled by a power of ten at the end, which is exact as long as both fit
+  // in a double, that is for anything an exporter writes in practice. Digits
+  // past the 19th, way past the precision of a float, are dropped.
+  static const char *obj_parse_float(const char *s, const char *end, float& value)
+  {
+    bool negative = false;
+    if(s != end && (*s == '-' || *s == '+'))
+      negative = *s++ == '-';
+
+    uint64_t mantissa = 0;
+    int      digits   = 0;
+    int      exponent = 0;
+    bool     any      = false;
+
+    for(; s != end && obj_is_digit(*s); ++s, any = true)
+      if(digits < 19)
+      {
+        mantissa = mantissa * 10 + (*s - '0');
+        digits  += mantissa != 0;
+      }
+      else
+        ++exponent;
+
+    if(s != end && *s == '.')
+      for(++s; s != end && obj_is_digit(*s); ++s, any = true)
+        if(digits < 19)
+        {
+          mantissa = mantissa * 10 + (*s - '0');
+          digits  += mantissa != 0;
+          --exponent;
+        }
+
+    if(!any)
+      return nullptr;
+
+    if(s != end && (*s == 'e' || *s == 'E'))
+    {
+      const char *e = s + 1;
+
+      bool exponent_negative = false;
+      if(e != end && (*e == '-' || *e == '+'))
+        exponent_negative = *e++ == '-';
+
+      if(e != end && obj_is_digit(*e))
+      {
+        int written = 0;
+        for(; e != end && obj_is_digit(*e); ++e)
+          written = std::min(written * 10 + (*e - '0'), 100000);
+
+        exponent += exponent_negative ? -written : written;
+        s = e;
+      }
+    }
+
+    double result = (double)mantissa;
+    if(mantissa == 0)
+      result = 0.0;
+    else if(exponent >= 0 && exponent < (int)std::size(OBJ_POWERS_OF_TEN))
+      result *= OBJ_POWERS_OF_TEN[exponent];
+    else if(exponent < 0 && -exponent < (int)std::size(OBJ_POWERS_OF_TEN))
+      result /= OBJ_POWERS_OF_TEN[-exponent];
+    else
+      result *= std::pow(10.0, exponent);
+
+    value = (float)(negative ? -result : result);
+    return s;
+  }
+
+  static const char *obj_parse_int(const char *s, const char *end, int32_t& value)
+  {
+    bool negative = false;
+    if(s != end && (*s == '-' || *s == '+'))
+      negative = *s++ == '-';
+
+    if(s == end || !obj_is_digit(*s))
+      return nullptr;
+
+    int64_t result = 0;
+    for(; s != end && obj_is_digit(*s); ++s)
+      result = std::min<int64_t>(result * 10 + (*s - '0'), INT32_MAX);
+
+    value = (int32_t)(negative ? -result : result);
+    return s;
+  }
+
+  // Append count components read from s, of which at least required must be
+  // present and the others default to zero. Anything after them, such as the
+  // w of a position or vertex colors, is ignored.
+  static bool obj_parse_floats(std::vector<float>& values, const char *s, const char *end, size_t required, size_t count)
+  {
+    for(size_t i=0; i<count; ++i)
+    {
+      float value = 0.0f;
+      if(const char *next = obj_parse_float(obj_skip_spaces(s, end), end, value))
+        s = next;
+      else if(i < required)
+        return false;
+
+      values.push_back(value);
+    }
+    return true;
+  }
+
+  static bool obj_parse_face(ObjSlice& slice, const char *s, const char *end)
+  {
+    uint32_t face_size = 0;
+    while((s = obj_skip_spaces(s, end)) != end)
+    {
+      ObjCorner corner = { { OBJ_NO_INDEX, OBJ_NO_INDEX, OBJ_NO_INDEX }, 0 };
+      for(size_t kind=0; kind<3; ++kind)
+      {
+        if(kind != 0)
+        {
+          if(s == end || *s != '/')
+            break;
+          ++s;
+        }
+
+        // Position//normal
+        if(kind == OBJ_UV && s != end && *s == '/')
+          continue;
+
+        int32_t index;
+        s = obj_parse_int(s, end, index);
+        if(!s || index == 0)
+          return false;
+
+        if(index > 0)
+          corner.indices[kind] = index - 1;
+        else
+        {
+          corner.indices[kind] = (int32_t)(slice.attributes[kind].size() / OBJ_COMPONENT_COUNTS[kind]) + index;
+          corner.relative |= 1u << kind;
+        }
+      }
+
+      if(s != end && !obj_is_space(*s))
+        return false;
+
+      slice.corners.push_back(corner);
+      ++face_size;
+    }
+
+    slice.face_sizes.push_back(face_size);
+    return true;
+  }
+
+  static bool obj_parse_line(ObjSlice& slice, const char *s, const char *end)
+  {
+    s = obj_skip_spaces(s, end);
+
+    const char *keyword = s;
+    while(s != end && !obj_is_space(*s))
+      ++s;
+
+    const std::string_view name(keyword, s - keyword);
+    if(name == "v")  return obj_parse_floats(slice.attributes[OBJ_POSITION], s, end, 3, 3);
+    if(name == "vt") return obj_parse_floats(slice.attributes[OBJ_UV],       s, end, 1, 2);
+    if(name == "vn") return obj_parse_floats(slice.attributes[OBJ_NORMAL],   s, end, 3, 3);
+    if(name == "f")  return obj_parse_face(slice, s, end);
+    return true;
+  }
+
+  static void obj_parse_slice(ObjSlice& slice)
+  {
+    for(const char *line = slice.begin; line != slice.end;)
+    {
+      const char *line_end = static_cast<const char *>(memchr(line, '\n', slice.end - line));
+      if(!line_end)
+        line_end = slice.end;
+
+      if(!obj_parse_line(slice, line, line_end))
+      {
+        slice.error = line;
+        return;
+      }
+      line = line_end == slice.end ? slice.end : line_end + 1;
+    }
+  }
+
+  // Find the index into the attributes of the whole file of the attribute of
+  // the given kind a corner refers to, OBJ_MISSING if it has none. Return
+  // false if the index is out of range.
+  static bool obj_resolve(const ObjSlice& slice, const std::vector<float> attributes[3], const ObjCorner& corner, size_t kind, uint32_t& value)
+  {
+    value = OBJ_MISSING;
+    if(corner.indices[kind] == OBJ_NO_INDEX)
+      return true;
+
+    int64_t index = corner.indices[kind];
+    if(corner.relative >> kind & 1)
+      index += slice.bases[kind];
+
+    if(index < 0 || (size_t)index >= attributes[kind].size() / OBJ_COMPONENT_COUNTS[kind])
+      return false;
+
+    value = (uint32_t)index;
+    return true;
+  }
+
+  // Split the faces of the slice into triangles, the same way tinyobj does for
+  // triangles and quads.
+  static void obj_triangulate_slice(ObjSlice& slice, const std::vector<float> attributes[3])
+  {
+    std::vector<ObjVertex> corners(slice.corners.size());
+    for(size_t i=0; i<slice.corners.size(); ++i)
+    {
+      uint32_t *indices = corners[i].indices;
+      if(!obj_resolve(slice, attributes, slice.corners[i], OBJ_POSITION, indices[OBJ_POSITION]) || indices[OBJ_POSITION] == OBJ_MISSING
+      || !obj_resolve(slice, attributes, slice.corners[i], OBJ_UV,       indices[OBJ_UV])
+      || !obj_resolve(slice, attributes, slice.corners[i], OBJ_NORMAL,   indices[OBJ_NORMAL]))
+      {
+        slice.error = slice.begin;
+        return;
+      }
+    }
+
+    const auto push = [&](size_t first, std::initializer_list<size_t> face_corners) {
+      for(size_t corner : face_corners)
+        slice.vertices.push_back(corners[first + corner]);
+    };
+
+    size_t first = 0;
+    for(uint32_t face_size : slice.face_sizes)
+    {
+      if(face_size == 4)
+      {
+        // Split along the shortest diagonal
+        const auto square_distance = [&](size_t a, size_t b) {
+          const float *p = &attributes[OBJ_POSITION][3 * corners[first + a].indices[OBJ_POSITION]];
+          const float *q = &attributes[OBJ_POSITION][3 * corners[first + b].indices[OBJ_POSITION]];
+          const float x = q[0] - p[0];
+          const float y = q[1] - p[1];
+          const float z = q[2] - p[2];
+          return x * x + y * y + z * z;
+        };
+
+        if(square_distance(0, 2) < square_distance(1, 3))
+          push(first, { 0, 1, 2, 0, 2, 3 });
+        else
+          push(first, { 0, 1, 3, 1, 2, 3 });
+      }
+      else
+      {
+        // Nothing at all for degenerate faces of less than 3 corners
+        for(size_t i=1; i+1<face_size; ++i)
+          push(first, { 0, i, i + 1 });
+      }
+      first += face_size;
+    }
+  }
+
+  // Run function on every slice, each on its own thread
+  static void obj_for_each_slice(std::vector<ObjSlice>& slices, auto function)
+  {
+    std::vector<std::thread> threads;
+    for(size_t i=1; i<slices.size(); ++i)
+      threads.emplace_back(function, std::ref(slices[i]));
+
+    function(slices[0]);
+    for(std::thread& thread : threads)
+      thread.join();
+  }
+
+  static void obj_check_slices(const char *file_name, const std::vector<ObjSlice>& slices, const char *message)
+  {
+    for(const ObjSlice& slice : slices)
+      if(slice.error)
+      {
+        const char *line_end = static_cast<const char *>(memchr(slice.error, '\n', slice.end - slice.error));
+        const int   length   = (int)std::min<size_t>((line_end ? line_end : slice.end) - slice.error, 80);
+        fprintf(stderr, "Failed to load object file:%s: %s near \"%.*s\"\n", file_name, message, length, slice.error);
+        abort();
+      }
+  }
+
+  void obj_parse(const char *file_name, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, size_t thread_count)
+  {
+    const int fd = LIBC_CHECK(open(file_name, O_RDONLY));
+
+    struct stat st;
+    LIBC_CHECK(fstat(fd, &st));
+    const size_t file_size = st.st_size;
+
+    const char *file = nullptr;
+    if(file_size != 0)
+    {
+      void *mapping = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if(mapping == MAP_FAILED)
+      {
+        perror("mmap");
+        abort();
+      }
+      file = static_cast<const char *>(mapping);
+    }
+    LIBC_CHECK(close(fd));
+
+    if(thread_count == 0)
+      thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+    thread_count = std::clamp<size_t>(file_size / OBJ_MIN_SLICE_SIZE, 1, thread_count);
+
+    // Cut the file into slices of about the same size, moving every cut to
+    // the start of the next line
+    std::vector<ObjSlice> slices(thread_count);
+    const char *begin = file;
+    for(size_t i=0; i<thread_count; ++i)
+    {
+      const char *end = std::max(file + file_size * (i + 1) / thread_count, begin);
+      if(end != file + file_size)
+      {
+        const char *line_end = static_cast<const char *>(memchr(end, '\n', file + file_size - end));
+        end = line_end ? line_end + 1 : file + file_size;
+      }
+
+      slices[i].begin = begin;
+      slices[i].end   = end;
+      begin = end;
+    }
+
+    obj_for_each_slice(slices, obj_parse_slice);
+    obj_check_slices(file_name, slices, "invalid record");
+
+    // Merge attributes in file order, so that indices can be resolved
+    std::vector<float> attributes[3];
+    for(size_t kind=0; kind<3; ++kind)
+    {
+      size_t count = 0;
+      for(const ObjSlice& slice : slices)
+        count += slice.attributes[kind].size();
+      attributes[kind].reserve(count);
+
+      for(ObjSlice& slice : slices)
+      {
+        slice.bases[kind] = attributes[kind].size() / OBJ_COMPONENT_COUNTS[kind];
+        attributes[kind].insert(attributes[kind].end(), slice.attributes[kind].begin(), slice.attributes[kind].end());
+        slice.attributes[kind] = {};
+      }
+    }
+
+    obj_for_each_slice(slices, [&](ObjSlice& slice) { obj_triangulate_slice(slice, attributes); });
+    obj_check_slices(file_name, slices, "invalid index in slice starting");
+
+    // Weld in file order, so that vertices are numbered by first use no
+    // matter how the file was sliced
+    size_t index_count = 0;
+    for(const ObjSlice& slice : slices)
+      index_count += slice.vertices.size();
+
+    VertexWelder           welder = vertex_welder_create(index_count);
+    std::vector<ObjVertex> obj_vertices;
+    indices.reserve(index_count);
+    for(ObjSlice& slice : slices)
+    {
+      for(const ObjVertex& vertex : slice.vertices)
+        indices.push_back(vertex_welder_insert(welder, obj_vertices, vertex));
+      slice.vertices = {};
+    }
+
+    const float *attribute_data[3] = { attributes[OBJ_POSITION].data(), attributes[OBJ_UV].data(), attributes[OBJ_NORMAL].data() };
+    obj_build_vertices(obj_vertices, attribute_data, vertices);
+    obj_weld_vertices(vertices, indices);
+
+    if(file)
+      LIBC_CHECK(munmap(const_cast<char *>(file), file_size));
+  }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "mesh.hpp"
+
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace vulkan
+{
+  // Parse the faces of an OBJ file into vertices and indices, welding
+  // together the corners that end up with the same position, normal and uv,
+  // first by the indices they refer to and then by value. Only v, vn, vt and
+  // f records are read, everything else such as groups and materials is
+  // ignored. Quads are split along their shortest diagonal and
+  // larger polygons into fans. Missing normals and uvs are left as zero.
+  //
+  // The file is mapped and split at line boundaries into one slice per
+  // thread, which are parsed in parallel and then merged in file order, so
+  // that the result does not depend on the number of threads. A thread_count
+  // of 0 use one thread per hardware thread.
+  void obj_parse(const char *file_name, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, size_t thread_count = 0);
+
+  // Same on top of tinyobj and on a single thread, kept as a reference to
+  // check and benchmark obj_parse against. Only faces of up to four corners
+  // give the same result, tinyobj splitting larger polygons differently.
+  void obj_parse_tinyobj(const char *file_name, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+}
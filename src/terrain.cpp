@@ -0,0 +1,143 @@
+#include "terrain.hpp"
+
+#include <stdint.h>
+
+static constexpr int   TERRAIN_BASE_HEIGHT = 48;
+static constexpr float TERRAIN_AMPLITUDE   = 40.0f;
+static constexpr float TERRAIN_FREQUENCY   = 1.0f / 64.0f; // Of the first octave, in blocks
+static constexpr int   TERRAIN_OCTAVES     = 4;
+static constexpr int   TERRAIN_SEA_LEVEL   = 40;
+static constexpr int   TERRAIN_SNOW_LINE   = 76;
+static constexpr int   TERRAIN_DIRT_DEPTH  = 4;
+
+// One lane per column. These are GCC vector extensions, also understood by
+// clang, and 4 lanes of 32 bits fit in the 128-bit vector registers that
+// every target we care about has without extra compiler flags.
+static constexpr size_t TERRAIN_LANES = 4;
+
+typedef float    f32xN __attribute__((vector_size(TERRAIN_LANES * sizeof(float))));
+typedef int32_t  i32xN __attribute__((vector_size(TERRAIN_LANES * sizeof(int32_t))));
+typedef uint32_t u32xN __attribute__((vector_size(TERRAIN_LANES * sizeof(uint32_t))));
+
+static i32xN terrain_floor(f32xN x)
+{
+  // Conversion truncates toward zero, and comparisons produce -1 in lanes
+  // where they hold, which fixes up negative non-integers.
+  const i32xN i = __builtin_convertvector(x, i32xN);
+  return i + (x < __builtin_convertvector(i, f32xN));
+}
+
+static u32xN terrain_hash(uint32_t seed, i32xN x, i32xN y)
+{
+  u32xN h = (u32xN)x * 0x8da6b343u ^ (u32xN)y * 0xd8163841u ^ seed * 0xcb1ab31fu;
+  h ^= h >> 16; h *= 0x7feb352du;
+  h ^= h >> 15; h *= 0x846ca68bu;
+  h ^= h >> 16;
+  return h;
+}
+
+// Dot product of the offset (x, y) with one of the 4 diagonal gradients
+// picked by the low bits of h.
+static f32xN terrain_gradient(u32xN h, f32xN x, f32xN y)
+{
+  const f32xN sx = __builtin_convertvector((i32xN)(h & 1u)        * 2 - 1, f32xN);
+  const f32xN sy = __builtin_convertvector((i32xN)((h >> 1) & 1u) * 2 - 1, f32xN);
+  return sx * x + sy * y;
+}
+
+static f32xN terrain_fade(f32xN t)
+{
+  return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+static f32xN terrain_lerp(f32xN a, f32xN b, f32xN t)
+{
+  return a + (b - a) * t;
+}
+
+// 2D gradient noise in roughly [-1, 1]
+static f32xN terrain_noise(uint32_t seed, f32xN x, f32xN y)
+{
+  const i32xN ix = terrain_floor(x);
+  const i32xN iy = terrain_floor(y);
+  const f32xN fx = x - __builtin_convertvector(ix, f32xN);
+  const f32xN fy = y - __builtin_convertvector(iy, f32xN);
+
+  const f32xN g00 = terrain_gradient(terrain_hash(seed, ix,     iy    ), fx,        fy       );
+  const f32xN g10 = terrain_gradient(terrain_hash(seed, ix + 1, iy    ), fx - 1.0f, fy       );
+  const f32xN g01 = terrain_gradient(terrain_hash(seed, ix,     iy + 1), fx,        fy - 1.0f);
+  const f32xN g11 = terrain_gradient(terrain_hash(seed, ix + 1, iy + 1), fx - 1.0f, fy - 1.0f);
+
+  const f32xN u = terrain_fade(fx);
+  const f32xN v = terrain_fade(fy);
+  return terrain_lerp(terrain_lerp(g00, g10, u), terrain_lerp(g01, g11, u), v);
+}
+
+// Height of the surface for TERRAIN_LANES columns, in blocks
+static i32xN terrain_surface(uint32_t seed, f32xN x, f32xN y)
+{
+  f32xN height    = {};
+  float frequency = TERRAIN_FREQUENCY;
+  float amplitude = TERRAIN_AMPLITUDE;
+  for(int octave=0; octave<TERRAIN_OCTAVES; ++octave)
+  {
+    height += terrain_noise(seed + octave, x * frequency, y * frequency) * amplitude;
+    frequency *= 2.0f;
+    amplitude *= 0.5f;
+  }
+
+  i32xN surface = TERRAIN_BASE_HEIGHT + terrain_floor(height);
+  surface = surface < 1 ? 1 : surface;
+  surface = surface > (int)TERRAIN_HEIGHT ? (int)TERRAIN_HEIGHT : surface;
+  return surface;
+}
+
+static BlockType terrain_block_type(int z, int surface)
+{
+  if(z >= surface)
+    return BlockType::AIR;
+
+  const bool beach = surface <= TERRAIN_SEA_LEVEL + 1;
+  if(z + 1 == surface)
+    return beach ? BlockType::SAND : surface >= TERRAIN_SNOW_LINE ? BlockType::SNOW : BlockType::GRASS;
+
+  if(z + TERRAIN_DIRT_DEPTH >= surface)
+    return beach ? BlockType::SAND : BlockType::DIRT;
+
+  return BlockType::STONE;
+}
+
+Chunk terrain_generate(uint32_t seed, glm::ivec2 coord)
+{
+  static_assert(CHUNK_SIZE * CHUNK_SIZE % TERRAIN_LANES == 0);
+
+  int surfaces[CHUNK_SIZE * CHUNK_SIZE];
+  for(size_t j=0; j<CHUNK_SIZE * CHUNK_SIZE; j+=TERRAIN_LANES)
+  {
+    f32xN x, y;
+    for(size_t lane=0; lane<TERRAIN_LANES; ++lane)
+    {
+      x[lane] = (float)(coord.x * (int)CHUNK_SIZE + (int)((j + lane) % CHUNK_SIZE));
+      y[lane] = (float)(coord.y * (int)CHUNK_SIZE + (int)((j + lane) / CHUNK_SIZE));
+    }
+
+    const i32xN surface = terrain_surface(seed, x, y);
+    for(size_t lane=0; lane<TERRAIN_LANES; ++lane)
+      surfaces[j + lane] = surface[lane];
+  }
+
+  // Fill in storage order rather than column by column, one layer at a time
+  Chunk chunk = chunk_create(TERRAIN_HEIGHT);
+  for(size_t z=0; z<chunk.height; ++z)
+  {
+    uint64_t layer = 0;
+    for(size_t j=0; j<CHUNK_SIZE * CHUNK_SIZE; ++j)
+    {
+      const BlockType type = terrain_block_type(z, surfaces[j]);
+      chunk.blocks[z * CHUNK_SIZE * CHUNK_SIZE + j] = type;
+      layer |= uint64_t(type != BlockType::AIR) << j;
+    }
+    chunk.occupancy[z] = layer;
+  }
+  return chunk;
+}
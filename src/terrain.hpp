@@ -0,0 +1,20 @@
+#pragma once
+
+#include "chunk.hpp"
+
+#include <glm/glm.hpp>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Heightmap terrain built from a few octaves of gradient noise, with stone
+// under a few layers of dirt topped by grass, sand close to the sea level and
+// snow on the peaks.
+//
+// The terrain is a pure function of the seed and of the world position of
+// each column, so a chunk comes out bit identical no matter which thread
+// generates it or in which order, and neighbouring chunks line up. The noise
+// is evaluated for several columns at a time using vector instructions.
+static constexpr size_t TERRAIN_HEIGHT = 128;
+
+Chunk terrain_generate(uint32_t seed, glm::ivec2 coord);
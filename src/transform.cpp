@@ -6,14 +6,19 @@ namespace vulkan
   glm::vec3 transform_forward(const Transform& camera) { return glm::rotate(camera.rotation, WORLD_FORWARD); }
   glm::vec3 transform_up(const Transform& camera)      { return glm::rotate(camera.rotation, WORLD_UP); }
 
-  void transform_translate_local(Transform& transform, glm::vec3 direction)
+  glm::vec3 transform_local_to_world(const Transform& transform, glm::vec3 direction)
   {
-    transform.position +=
+    return
       direction.x * transform_right(transform) +
       direction.y * transform_forward(transform) +
       direction.z * transform_up(transform);
   }
 
+  void transform_translate_local(Transform& transform, glm::vec3 direction)
+  {
+    transform.position += transform_local_to_world(transform, direction);
+  }
+
   void transform_set_euler_angle(Transform& transform, float yaw, float pitch, float roll)
   {
     transform.rotation =
@@ -21,6 +21,9 @@ namespace vulkan
   glm::vec3 transform_left(const Transform& transform);
   glm::vec3 transform_up(const Transform& transform);
 
+  // Direction given in the local frame of the transform, in world space
+  glm::vec3 transform_local_to_world(const Transform& transform, glm::vec3 direction);
+
   void transform_translate_local(Transform& transform, glm::vec3 direction);
   void transform_set_euler_angle(Transform& transform, float yaw, float pitch, float roll);
 
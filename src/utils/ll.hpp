@@ -45,6 +45,7 @@ inline void ll_init(struct ll *ll)
 inline struct ll_node *ll_front(struct ll *ll) { return ll->sentinel.next; }
 inline struct ll_node *ll_back(struct ll *ll)  { return ll->sentinel.prev; }
 inline struct ll_node *ll_sentinel(struct ll *ll)  { return &ll->sentinel; }
+inline bool ll_empty(struct ll *ll) { return ll_front(ll) == ll_sentinel(ll); }
 
 inline void ll_prepend(struct ll *ll, struct ll_node *node) { ll_insert_before(ll_front(ll), node); }
 inline void ll_append(struct ll *ll, struct ll_node *node)  { ll_insert_after(ll_back(ll), node);   }